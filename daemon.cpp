@@ -0,0 +1,49 @@
+#include <csignal>
+#include <iostream>
+
+#include <gpgpu/Context.hpp>
+#include <gpgpu/daemon/Server.hpp>
+
+using namespace std;
+
+static gpgpu::daemon::RenderServer *server = nullptr;
+
+static void stop(int) {
+    if (server != nullptr) {
+        server->stop();
+    }
+}
+
+int main(int argc, char **argv) {
+    const string path = argc > 1 ? argv[1] : gpgpu::daemon::DEFAULT_SOCKET_PATH;
+
+    /*
+     * Context, kept warm for all jobs.
+     */
+    gpgpu::Context context;
+    cout << context << endl;
+
+    gpgpu::daemon::RenderServer render_server(path);
+    server = &render_server;
+
+    /*
+     * Interrupt poll() on SIGINT/SIGTERM (no SA_RESTART) and shut down cleanly.
+     */
+    struct sigaction action = {};
+    action.sa_handler = stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    cout << "listening on " << path << endl;
+    render_server.run();
+
+    server = nullptr;
+    cout << render_server.jobs() << " jobs served" << endl;
+    cout << context.memory()->statistics();
+
+#ifdef GPGPU_INSTRUMENTATION
+    gpgpu::Instrumentation::instance().write_summary(cout);
+#endif
+
+    return 0;
+}
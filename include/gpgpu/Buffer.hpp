@@ -23,7 +23,13 @@
 #ifndef GPGPU_OPENGL_BUFFER_HPP
 #define GPGPU_OPENGL_BUFFER_HPP
 
+#include <algorithm>
+#include <limits>
+#include <vector>
+
 #include "OpenGLObject.hpp"
+#include "MemoryTracker.hpp"
+#include "Quantize.hpp"
 
 namespace gpgpu {
     class Buffer : public OpenGLObject {
@@ -58,11 +64,17 @@ namespace gpgpu {
 
         template<typename T>
         void data(size_t elements, unsigned char dimension, ValueType valueType, const T *ptr) {
+            const size_t size = elements * dimension * sizeof(T);
+
+            // Throws if the budget is exceeded, before the buffer's description changes.
+            _memory.resize(size);
+
             _elements = elements;
             _dimension = dimension;
             _valueType = valueType;
+            _normalized = false;
 
-            data(_elements * _dimension * sizeof(T), ptr);
+            data(size, ptr);
         }
 
         void data(size_t elements, unsigned char dimension, const double *ptr) {
@@ -77,6 +89,57 @@ namespace gpgpu {
             data(elements, dimension, Buffer::UnsignedInteger, ptr);
         }
 
+        void data(size_t elements, unsigned char dimension, const unsigned short *ptr) {
+            data(elements, dimension, Buffer::UnsignedShort, ptr);
+        }
+
+        void data(size_t elements, unsigned char dimension, const unsigned char *ptr) {
+            data(elements, dimension, Buffer::UnsignedByte, ptr);
+        }
+
+        /**
+         * Allocates storage without initializing it, fill it with sub_data().
+         */
+        void allocate(size_t elements, unsigned char dimension, ValueType valueType, GLenum usage = GL_STATIC_DRAW) {
+            _memory.resize(elements * dimension * value_size(valueType));
+
+            _elements = elements;
+            _dimension = dimension;
+            _valueType = valueType;
+            _normalized = false;
+
+            data(bytes(), nullptr, usage);
+        }
+
+        void sub_data(size_t offset, size_t size, const void *ptr) {
+            if (offset + size > bytes()) {
+                std::stringstream s;
+                s << "Range [" << offset << ", " << offset + size << ") exceeds buffer size (" << bytes() << ").";
+                throw OpenGLError(s.str());
+            }
+
+            glBindBuffer(_bufferType, _id);
+            glBufferSubData(_bufferType, offset, size, ptr);
+            assertNoGLError("glBufferSubData");
+            GPGPU_TRACE_UPLOAD("Buffer::sub_data", size);
+        }
+
+        static size_t value_size(ValueType valueType) {
+            switch (valueType) {
+                case Byte:
+                case UnsignedByte:
+                    return 1;
+                case Short:
+                case UnsignedShort:
+                case HalfFloat:
+                    return 2;
+                case Double:
+                    return 8;
+                default:
+                    return 4;
+            }
+        }
+
         GLuint id() const {
             return _id;
         }
@@ -93,29 +156,145 @@ namespace gpgpu {
             return _valueType;
         }
 
+        /**
+         * Integer values are mapped to [0, 1] (unsigned) or [-1, 1] (signed) when read as attribute.
+         */
+        bool normalized() const {
+            return _normalized;
+        }
+
+        virtual size_t bytes() const {
+            return _elements * _dimension * value_size(_valueType);
+        }
+
+        /**
+         * Groups the buffer's memory under `label` in MemoryTracker statistics.
+         */
+        void label(const std::string &label) {
+            _memory.label(label);
+        }
+
     protected:
         BufferType _bufferType;
-        ValueType _valueType;
-        size_t _elements;
-        unsigned char _dimension;
+        ValueType _valueType = Float;
+        size_t _elements = 0;
+        unsigned char _dimension = 0;
+        bool _normalized = false;
         GLuint _id;
+        MemoryAllocation _memory{MemoryTracker::BufferMemory};
+
+        void data(size_t size, const void *ptr, GLenum usage = GL_STATIC_DRAW) {
+            _memory.resize(size);
 
-        void data(size_t size, const void *ptr) {
             glBindBuffer(_bufferType, _id);
-            glBufferData(_bufferType, size, ptr, GL_STATIC_DRAW);
+            glBufferData(_bufferType, size, ptr, usage);
             assertNoGLError("glBufferData");
+
+            if (ptr != nullptr) {
+                GPGPU_TRACE_UPLOAD("Buffer::data", size);
+            }
         }
     };
 
+    /**
+     * Maps C++ types to Buffer::ValueType.
+     */
+    template<typename T>
+    struct BufferValueType;
+
+    template<>
+    struct BufferValueType<char> {
+        static constexpr Buffer::ValueType value = Buffer::Byte;
+    };
+
+    template<>
+    struct BufferValueType<signed char> {
+        static constexpr Buffer::ValueType value = Buffer::Byte;
+    };
+
+    template<>
+    struct BufferValueType<unsigned char> {
+        static constexpr Buffer::ValueType value = Buffer::UnsignedByte;
+    };
+
+    template<>
+    struct BufferValueType<short> {
+        static constexpr Buffer::ValueType value = Buffer::Short;
+    };
+
+    template<>
+    struct BufferValueType<unsigned short> {
+        static constexpr Buffer::ValueType value = Buffer::UnsignedShort;
+    };
+
+    template<>
+    struct BufferValueType<int> {
+        static constexpr Buffer::ValueType value = Buffer::Integer;
+    };
+
+    template<>
+    struct BufferValueType<unsigned int> {
+        static constexpr Buffer::ValueType value = Buffer::UnsignedInteger;
+    };
+
+    template<>
+    struct BufferValueType<float> {
+        static constexpr Buffer::ValueType value = Buffer::Float;
+    };
+
+    template<>
+    struct BufferValueType<double> {
+        static constexpr Buffer::ValueType value = Buffer::Double;
+    };
+
     class ArrayBuffer : public Buffer {
     public:
         ArrayBuffer() : Buffer(Buffer::Array) {
 
         }
 
+        /**
+         * Converts float attributes to a compact type and uploads them:
+         * HalfFloat, Short (normalized, [-1, 1]) or UnsignedByte
+         * (normalized, [0, 1]). Float uploads unchanged.
+         */
+        void quantized_data(size_t elements, unsigned char dimension, ValueType valueType, const float *ptr) {
+            const size_t n = elements * dimension;
+
+            switch (valueType) {
+                case Buffer::Float:
+                    data(elements, dimension, ptr);
+                    return;
+                case Buffer::HalfFloat: {
+                    std::vector<uint16_t> q(n);
+                    quantize_half(ptr, q.data(), n);
+                    data(elements, dimension, Buffer::HalfFloat, q.data());
+                    return;
+                }
+                case Buffer::Short: {
+                    std::vector<int16_t> q(n);
+                    quantize_snorm16(ptr, q.data(), n);
+                    data(elements, dimension, Buffer::Short, q.data());
+                    break;
+                }
+                case Buffer::UnsignedByte: {
+                    std::vector<uint8_t> q(n);
+                    quantize_unorm8(ptr, q.data(), n);
+                    data(elements, dimension, Buffer::UnsignedByte, q.data());
+                    break;
+                }
+                default:
+                    std::stringstream s;
+                    s << "Can't quantize to value type 0x" << std::hex << valueType << ".";
+                    throw OpenGLError(s.str());
+            }
+
+            _normalized = true;
+        }
+
         void bind(GLuint index) const {
             glBindBuffer(_bufferType, _id);
-            glVertexAttribPointer(index, _dimension, _valueType, GL_FALSE, 0, nullptr);
+            glVertexAttribPointer(index, _dimension, _valueType, _normalized ? GL_TRUE : GL_FALSE, 0, nullptr);
             assertNoGLError("glVertexAttribPointer");
         }
     };
@@ -136,6 +315,26 @@ namespace gpgpu {
             return _mode;
         }
 
+        /**
+         * Stores the indices with the narrowest type that holds the largest
+         * index: 8 bit below 256 vertices (if allowed), 16 bit below 65536.
+         */
+        void data_compact(size_t elements, unsigned char dimension, const unsigned int *ptr,
+                          bool allow_byte = true) {
+            const size_t count = elements * dimension;
+            const unsigned int max = count == 0 ? 0 : *std::max_element(ptr, ptr + count);
+
+            if (allow_byte && max <= std::numeric_limits<unsigned char>::max()) {
+                std::vector<unsigned char> narrow(ptr, ptr + count);
+                data(elements, dimension, narrow.data());
+            } else if (max <= std::numeric_limits<unsigned short>::max()) {
+                std::vector<unsigned short> narrow(ptr, ptr + count);
+                data(elements, dimension, narrow.data());
+            } else {
+                data(elements, dimension, ptr);
+            }
+        }
+
     protected:
         GLenum _mode;
     };
@@ -0,0 +1,297 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_COMMANDLIST_HPP
+#define GPGPU_OPENGL_COMMANDLIST_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "Buffer.hpp"
+#include "Program.hpp"
+#include "Texture.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class CommandListError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Records program, uniform, attribute and render calls without touching
+     * OpenGL, so worker threads can prepare draws while the thread owning
+     * the Context replays them with execute(), in recording order.
+     *
+     * Commands are packed into one growing byte arena that keeps its
+     * capacity across clear(), resources are kept alive until then. A list
+     * must only be used by one thread at a time.
+     */
+    class CommandList {
+    public:
+        void use(std::shared_ptr<Program> program);
+
+        void uniform(const std::string &name, int value);
+
+        void uniform(const std::string &name, unsigned int value) {
+            uniform(name, (int) value);
+        }
+
+        void uniform(const std::string &name, float value);
+
+        void uniform(const std::string &name, std::shared_ptr<Texture> texture);
+
+        template<int _Rows, int _Cols, int _Options, int _MaxRows, int _MaxCols>
+        void uniform(const std::string &name,
+                     const Eigen::Matrix<float, _Rows, _Cols, _Options, _MaxRows, _MaxCols> &value,
+                     size_t arrayLength = 1);
+
+        void attribute(const std::string &name, std::shared_ptr<ArrayBuffer> buffer);
+
+        void render(std::shared_ptr<ElementArrayBuffer> faces);
+
+        void render(std::shared_ptr<ArrayBuffer> vertices, const std::string &location, GLenum mode);
+
+        /**
+         * Replays all commands, has to run on the thread owning the Context.
+         */
+        void execute() const;
+
+        /**
+         * Drops commands and resources, the arena's memory is reused.
+         */
+        void clear();
+
+        size_t size() const {
+            return _commands;
+        }
+
+        size_t bytes() const {
+            return _arena.size();
+        }
+
+    protected:
+        enum Opcode : uint32_t {
+            UseProgram,
+            UniformInt,
+            UniformFloat,
+            UniformMatrix,
+            UniformTexture,
+            Attribute,
+            RenderElements,
+            RenderArrays
+        };
+
+        /**
+         * Followed by the name's characters and `payload` bytes.
+         */
+        struct Header {
+            uint32_t opcode;
+            uint32_t name;
+            uint32_t payload;
+        };
+
+        std::vector<unsigned char> _arena;
+        size_t _commands = 0;
+
+        std::vector<std::shared_ptr<Program>> _programs;
+        std::vector<std::shared_ptr<Buffer>> _buffers;
+        std::vector<std::shared_ptr<Texture>> _textures;
+
+        /**
+         * Appends a command and returns where its payload goes.
+         */
+        unsigned char *record(Opcode opcode, const std::string &name, size_t payload);
+
+        template<typename T>
+        void record(Opcode opcode, const std::string &name, const T &payload) {
+            std::memcpy(record(opcode, name, sizeof(T)), &payload, sizeof(T));
+        }
+
+        template<typename T>
+        static T read(const unsigned char *&position) {
+            T value;
+            std::memcpy(&value, position, sizeof(T));
+            position += sizeof(T);
+            return value;
+        }
+    };
+
+
+    /*
+     * Definition
+     */
+    inline unsigned char *CommandList::record(Opcode opcode, const std::string &name, size_t payload) {
+        const Header header = {opcode, static_cast<uint32_t>(name.size()), static_cast<uint32_t>(payload)};
+        const size_t offset = _arena.size();
+
+        _arena.resize(offset + sizeof(header) + name.size() + payload);
+        std::memcpy(&_arena[offset], &header, sizeof(header));
+        std::memcpy(&_arena[offset + sizeof(header)], name.data(), name.size());
+        ++_commands;
+
+        return &_arena[offset + sizeof(header) + name.size()];
+    }
+
+    inline void CommandList::use(std::shared_ptr<Program> program) {
+        record(UseProgram, std::string(), static_cast<uint32_t>(_programs.size()));
+        _programs.push_back(program);
+    }
+
+    inline void CommandList::uniform(const std::string &name, int value) {
+        record(UniformInt, name, value);
+    }
+
+    inline void CommandList::uniform(const std::string &name, float value) {
+        record(UniformFloat, name, value);
+    }
+
+    inline void CommandList::uniform(const std::string &name, std::shared_ptr<Texture> texture) {
+        record(UniformTexture, name, static_cast<uint32_t>(_textures.size()));
+        _textures.push_back(texture);
+    }
+
+    template<int _Rows, int _Cols, int _Options, int _MaxRows, int _MaxCols>
+    void CommandList::uniform(const std::string &name,
+                              const Eigen::Matrix<float, _Rows, _Cols, _Options, _MaxRows, _MaxCols> &value,
+                              size_t arrayLength) {
+        const uint32_t shape[] = {
+                static_cast<uint32_t>(value.rows() / arrayLength),
+                static_cast<uint32_t>(value.cols()),
+                static_cast<uint32_t>(arrayLength)
+        };
+
+        const size_t values = value.size() * sizeof(float);
+        auto position = record(UniformMatrix, name, sizeof(shape) + values);
+        std::memcpy(position, shape, sizeof(shape));
+        position += sizeof(shape);
+
+        // Stored column-major, as OpenGL expects it.
+        for (Eigen::Index c = 0; c < value.cols(); ++c) {
+            for (Eigen::Index r = 0; r < value.rows(); ++r) {
+                const float v = value(r, c);
+                std::memcpy(position, &v, sizeof(v));
+                position += sizeof(v);
+            }
+        }
+    }
+
+    inline void CommandList::attribute(const std::string &name, std::shared_ptr<ArrayBuffer> buffer) {
+        record(Attribute, name, static_cast<uint32_t>(_buffers.size()));
+        _buffers.push_back(buffer);
+    }
+
+    inline void CommandList::render(std::shared_ptr<ElementArrayBuffer> faces) {
+        record(RenderElements, std::string(), static_cast<uint32_t>(_buffers.size()));
+        _buffers.push_back(faces);
+    }
+
+    inline void CommandList::render(std::shared_ptr<ArrayBuffer> vertices, const std::string &location,
+                                    GLenum mode) {
+        const uint32_t payload[] = {static_cast<uint32_t>(_buffers.size()), static_cast<uint32_t>(mode)};
+        std::memcpy(record(RenderArrays, location, sizeof(payload)), payload, sizeof(payload));
+        _buffers.push_back(vertices);
+    }
+
+    inline void CommandList::clear() {
+        _arena.clear();
+        _commands = 0;
+        _programs.clear();
+        _buffers.clear();
+        _textures.clear();
+    }
+
+    inline void CommandList::execute() const {
+        const unsigned char *position = _arena.data();
+        const unsigned char *end = position + _arena.size();
+
+        Program *program = nullptr;
+        std::vector<float> matrix;
+        std::string name;
+
+        while (position < end) {
+            const auto header = read<Header>(position);
+            name.assign(reinterpret_cast<const char *>(position), header.name);
+            position += header.name;
+
+            const unsigned char *payload = position;
+            position += header.payload;
+
+            if (header.opcode != UseProgram && program == nullptr) {
+                throw CommandListError("Command recorded before a program was used.");
+            }
+
+            switch (header.opcode) {
+                case UseProgram:
+                    program = _programs[read<uint32_t>(payload)].get();
+                    program->use();
+                    break;
+                case UniformInt:
+                    program->uniform(name, read<int>(payload));
+                    break;
+                case UniformFloat:
+                    program->uniform(name, read<float>(payload));
+                    break;
+                case UniformMatrix: {
+                    const auto rows = read<uint32_t>(payload);
+                    const auto cols = read<uint32_t>(payload);
+                    const auto arrayLength = read<uint32_t>(payload);
+
+                    // The arena gives no alignment guarantees, copy before handing out floats.
+                    matrix.resize(size_t(rows) * cols * arrayLength);
+                    std::memcpy(matrix.data(), payload, matrix.size() * sizeof(float));
+                    program->setUniformLocation(program->uniformLocation(name), rows, cols, matrix.data(),
+                                                arrayLength);
+                    break;
+                }
+                case UniformTexture:
+                    program->uniform(name, _textures[read<uint32_t>(payload)]);
+                    break;
+                case Attribute:
+                    program->attribute(name,
+                                       std::static_pointer_cast<ArrayBuffer>(_buffers[read<uint32_t>(payload)]));
+                    break;
+                case RenderElements:
+                    program->render(*std::static_pointer_cast<ElementArrayBuffer>(_buffers[read<uint32_t>(payload)]));
+                    break;
+                case RenderArrays: {
+                    const auto buffer = read<uint32_t>(payload);
+                    const auto mode = read<uint32_t>(payload);
+                    program->render(std::static_pointer_cast<ArrayBuffer>(_buffers[buffer]), name, mode);
+                    break;
+                }
+                default:
+                    throw CommandListError("Corrupt command list.");
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_OPENGL_COMMANDLIST_HPP */
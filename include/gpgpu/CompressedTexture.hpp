@@ -0,0 +1,651 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_COMPRESSEDTEXTURE_HPP
+#define GPGPU_OPENGL_COMPRESSEDTEXTURE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "OpenGLObject.hpp"
+#include "MappedFile.hpp"
+#include "Texture.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class CompressedTextureError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Block compressed 2D image or image array with mip levels, memory
+     * mapped from a KTX (version 1) or DDS file. Nothing is decoded, levels
+     * point into the mapping and are handed to OpenGL as stored.
+     *
+     * BC1-BC7 (S3TC, RGTC, BPTC) and ETC2/EAC are recognized, cube maps and
+     * volume textures are not supported.
+     */
+    class CompressedImage {
+    public:
+        enum Container {
+            KTX,
+            DDS
+        };
+
+        /**
+         * Maps and parses `filename`, needs a current context to check the
+         * size against GL_MAX_TEXTURE_SIZE.
+         */
+        explicit CompressedImage(const std::string &filename);
+
+        CompressedImage(const CompressedImage &) = delete;
+
+        CompressedImage &operator=(const CompressedImage &) = delete;
+
+        Container container() const {
+            return _container;
+        }
+
+        GLenum internal_format() const {
+            return _internal_format;
+        }
+
+        unsigned int width(unsigned int level = 0) const {
+            return std::max(_width >> level, 1u);
+        }
+
+        unsigned int height(unsigned int level = 0) const {
+            return std::max(_height >> level, 1u);
+        }
+
+        unsigned int layers() const {
+            return _layers;
+        }
+
+        unsigned int levels() const {
+            return _levels;
+        }
+
+        /**
+         * Bytes of one layer of `level`.
+         */
+        size_t level_size(unsigned int level) const {
+            return size_t((width(level) + 3) / 4) * ((height(level) + 3) / 4) * block_bytes(_internal_format);
+        }
+
+        /**
+         * Bytes of all levels and layers.
+         */
+        size_t bytes() const;
+
+        const unsigned char *data(unsigned int level, unsigned int layer = 0) const {
+            return _file.data() + offset(level, layer);
+        }
+
+        /**
+         * Whether the layers of `level` are stored back to back (KTX) and
+         * can be uploaded with one call.
+         */
+        bool contiguous(unsigned int level) const;
+
+        /**
+         * Drops the pages of `level` from the mapping once uploaded, see MappedFile::release().
+         */
+        void release(unsigned int level) const;
+
+        const std::string &filename() const {
+            return _file.filename();
+        }
+
+        /**
+         * Bytes per 4x4 block, throws for formats that aren't recognized.
+         */
+        static size_t block_bytes(GLenum internal_format);
+
+        /**
+         * Whether the current context samples `internal_format`.
+         */
+        static bool supported(GLenum internal_format);
+
+        static void assert_supported(GLenum internal_format);
+
+    protected:
+        enum Family {
+            S3TC,
+            S3TC_SRGB,
+            RGTC,
+            BPTC,
+            ETC2
+        };
+
+        struct Format {
+            GLenum internal_format;
+            size_t block_bytes;
+            Family family;
+            const char *name;
+        };
+
+        MappedFile _file;
+        Container _container = KTX;
+        GLenum _internal_format = 0;
+        unsigned int _width = 0;
+        unsigned int _height = 0;
+        unsigned int _layers = 1;
+        unsigned int _levels = 1;
+
+        // Offset of every level and layer, level * _layers + layer.
+        std::vector<size_t> _offsets;
+
+        size_t offset(unsigned int level, unsigned int layer) const {
+            return _offsets.at(size_t(level) * _layers + layer);
+        }
+
+        uint32_t word(size_t offset) const {
+            uint32_t value;
+            std::memcpy(&value, _file.data() + offset, sizeof(value));
+            return value;
+        }
+
+        void assert_dimensions() const {
+            GLint max_size = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+            // Also keeps the block counts of level_size() from wrapping.
+            if (_width == 0 || _height == 0 || _width > static_cast<unsigned int>(max_size) ||
+                _height > static_cast<unsigned int>(max_size) || _layers > 65536 || _levels > 32 ||
+                (std::max(_width, _height) >> (_levels - 1)) == 0) {
+                throw CompressedTextureError("“" + filename() + "” has an invalid size or number of levels.");
+            }
+        }
+
+        void parse_ktx();
+
+        void parse_dds();
+
+        static const Format &format(GLenum internal_format);
+
+        static GLenum dds_format(uint32_t four_cc);
+
+        static GLenum dxgi_format(uint32_t dxgi_format);
+    };
+
+    /**
+     * Texture2D with all levels of a compressed image, sampled trilinearly
+     * if there is more than one. Can't be read back or rendered to.
+     */
+    class CompressedTexture2D : public Texture2D {
+    public:
+        explicit CompressedTexture2D(const CompressedImage &image);
+
+        explicit CompressedTexture2D(const std::string &filename)
+                : CompressedTexture2D(CompressedImage(filename)) {
+
+        }
+
+        GLenum internal_format() const {
+            return _internal_format;
+        }
+
+        unsigned int levels() const {
+            return _levels;
+        }
+
+    protected:
+        GLenum _internal_format;
+        unsigned int _levels;
+    };
+
+    /**
+     * TextureArray2D with all levels of a compressed image array, or of one
+     * single layer image per file.
+     */
+    class CompressedTextureArray2D : public TextureArray2D {
+    public:
+        explicit CompressedTextureArray2D(const CompressedImage &image);
+
+        /**
+         * One layer per file, all with the same format, size and levels.
+         * Files are mapped one at a time and released after upload, so
+         * the resident size stays around one file.
+         */
+        explicit CompressedTextureArray2D(const std::vector<std::string> &filenames);
+
+        GLenum internal_format() const {
+            return _internal_format;
+        }
+
+        unsigned int levels() const {
+            return _levels;
+        }
+
+    protected:
+        GLenum _internal_format = 0;
+        unsigned int _width = 0;
+        unsigned int _height = 0;
+        unsigned int _levels = 0;
+
+        void allocate(const CompressedImage &image, unsigned int layers);
+
+        void upload(const CompressedImage &image, unsigned int first);
+    };
+
+
+    /*
+     * Definition
+     */
+    inline CompressedImage::CompressedImage(const std::string &filename) : _file(filename) {
+        static const unsigned char KTX_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A,
+                                                         '\n'};
+
+        if (_file.size() >= 64 && std::memcmp(_file.data(), KTX_IDENTIFIER, sizeof(KTX_IDENTIFIER)) == 0) {
+            _container = KTX;
+            parse_ktx();
+        } else if (_file.size() >= 128 && std::memcmp(_file.data(), "DDS ", 4) == 0) {
+            _container = DDS;
+            parse_dds();
+        } else {
+            throw CompressedTextureError("“" + filename + "” is neither a KTX nor a DDS file.");
+        }
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            for (unsigned int layer = 0; layer < _layers; ++layer) {
+                if (offset(level, layer) + level_size(level) > _file.size()) {
+                    throw CompressedTextureError("“" + filename + "” is truncated.");
+                }
+            }
+        }
+    }
+
+    inline void CompressedImage::parse_ktx() {
+        if (word(12) != 0x04030201) {
+            throw CompressedTextureError("“" + filename() + "” has a foreign byte order.");
+        }
+
+        // glType and glFormat are zero for compressed data.
+        if (word(16) != 0 || word(24) != 0) {
+            throw CompressedTextureError("“" + filename() + "” is not block compressed.");
+        }
+
+        _internal_format = word(28);
+        _width = word(36);
+        _height = word(40);
+        _layers = std::max(word(48), 1u);
+        _levels = std::max(word(56), 1u);
+
+        if (word(44) > 1 || word(52) != 1) {
+            throw CompressedTextureError("“" + filename() + "” is a volume texture or cube map.");
+        }
+
+        block_bytes(_internal_format);
+        assert_dimensions();
+
+        size_t position = 64 + size_t(word(60));
+        _offsets.reserve(size_t(_levels) * _layers);
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            if (position + 4 > _file.size()) {
+                throw CompressedTextureError("“" + filename() + "” is truncated.");
+            }
+
+            // Non-cube-map levels hold all layers, imageSize counts them all.
+            const size_t size = word(position);
+            position += 4;
+
+            if (size != level_size(level) * _layers) {
+                std::stringstream s;
+                s << "“" << filename() << "” level " << level << " has " << size << " bytes instead of " <<
+                        level_size(level) * _layers << ".";
+                throw CompressedTextureError(s.str());
+            }
+
+            for (unsigned int layer = 0; layer < _layers; ++layer) {
+                _offsets.push_back(position + layer * level_size(level));
+            }
+
+            position += (size + 3) / 4 * 4;
+        }
+    }
+
+    inline void CompressedImage::parse_dds() {
+        const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+        const uint32_t DDPF_FOURCC = 0x4;
+        const uint32_t DDSCAPS2_CUBEMAP = 0x200;
+        const uint32_t DDSCAPS2_VOLUME = 0x200000;
+
+        if (word(4) != 124 || word(76) != 32) {
+            throw CompressedTextureError("“" + filename() + "” has an invalid DDS header.");
+        }
+
+        _height = word(12);
+        _width = word(16);
+        _levels = (word(8) & DDSD_MIPMAPCOUNT) ? std::max(word(28), 1u) : 1;
+
+        if (word(112) & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME)) {
+            throw CompressedTextureError("“" + filename() + "” is a volume texture or cube map.");
+        }
+
+        if (!(word(80) & DDPF_FOURCC)) {
+            throw CompressedTextureError("“" + filename() + "” is not block compressed.");
+        }
+
+        size_t position = 128;
+
+        if (word(84) == 0x30315844) { // "DX10"
+            if (_file.size() < 148) {
+                throw CompressedTextureError("“" + filename() + "” is truncated.");
+            }
+
+            const uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+            const uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+            if (word(132) != DDS_DIMENSION_TEXTURE2D || (word(136) & DDS_RESOURCE_MISC_TEXTURECUBE)) {
+                throw CompressedTextureError("“" + filename() + "” is not a 2D texture (array).");
+            }
+
+            _internal_format = dxgi_format(word(128));
+            _layers = std::max(word(140), 1u);
+            position = 148;
+        } else {
+            _internal_format = dds_format(word(84));
+        }
+
+        assert_dimensions();
+
+        // Layer after layer, each with all its levels.
+        _offsets.resize(size_t(_levels) * _layers);
+
+        for (unsigned int layer = 0; layer < _layers; ++layer) {
+            for (unsigned int level = 0; level < _levels; ++level) {
+                _offsets[size_t(level) * _layers + layer] = position;
+                position += level_size(level);
+            }
+        }
+    }
+
+    inline size_t CompressedImage::bytes() const {
+        size_t bytes = 0;
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            bytes += level_size(level) * _layers;
+        }
+
+        return bytes;
+    }
+
+    inline bool CompressedImage::contiguous(unsigned int level) const {
+        for (unsigned int layer = 1; layer < _layers; ++layer) {
+            if (offset(level, layer) != offset(level, layer - 1) + level_size(level)) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline void CompressedImage::release(unsigned int level) const {
+        for (unsigned int layer = 0; layer < _layers; ++layer) {
+            _file.release(offset(level, layer), level_size(level));
+        }
+    }
+
+    inline const CompressedImage::Format &CompressedImage::format(GLenum internal_format) {
+        static const Format formats[] = {
+                {GL_COMPRESSED_RGB_S3TC_DXT1_EXT,                  8,  S3TC, "BC1"},
+                {GL_COMPRESSED_RGBA_S3TC_DXT1_EXT,                 8,  S3TC, "BC1"},
+                {GL_COMPRESSED_SRGB_S3TC_DXT1_EXT,                 8,  S3TC_SRGB, "BC1 sRGB"},
+                {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT,           8,  S3TC_SRGB, "BC1 sRGB"},
+                {GL_COMPRESSED_RGBA_S3TC_DXT3_EXT,                 16, S3TC, "BC2"},
+                {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT,           16, S3TC_SRGB, "BC2 sRGB"},
+                {GL_COMPRESSED_RGBA_S3TC_DXT5_EXT,                 16, S3TC, "BC3"},
+                {GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT,           16, S3TC_SRGB, "BC3 sRGB"},
+                {GL_COMPRESSED_RED_RGTC1,                          8,  RGTC, "BC4"},
+                {GL_COMPRESSED_SIGNED_RED_RGTC1,                   8,  RGTC, "BC4 signed"},
+                {GL_COMPRESSED_RG_RGTC2,                           16, RGTC, "BC5"},
+                {GL_COMPRESSED_SIGNED_RG_RGTC2,                    16, RGTC, "BC5 signed"},
+                {GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT,            16, BPTC, "BC6H"},
+                {GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT,              16, BPTC, "BC6H signed"},
+                {GL_COMPRESSED_RGBA_BPTC_UNORM,                    16, BPTC, "BC7"},
+                {GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM,              16, BPTC, "BC7 sRGB"},
+                {GL_COMPRESSED_RGB8_ETC2,                          8,  ETC2, "ETC2 RGB"},
+                {GL_COMPRESSED_SRGB8_ETC2,                         8,  ETC2, "ETC2 sRGB"},
+                {GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2,      8,  ETC2, "ETC2 RGB A1"},
+                {GL_COMPRESSED_SRGB8_PUNCHTHROUGH_ALPHA1_ETC2,     8,  ETC2, "ETC2 sRGB A1"},
+                {GL_COMPRESSED_RGBA8_ETC2_EAC,                     16, ETC2, "ETC2 RGBA"},
+                {GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC,              16, ETC2, "ETC2 sRGB A8"},
+                {GL_COMPRESSED_R11_EAC,                            8,  ETC2, "EAC R11"},
+                {GL_COMPRESSED_SIGNED_R11_EAC,                     8,  ETC2, "EAC R11 signed"},
+                {GL_COMPRESSED_RG11_EAC,                           16, ETC2, "EAC RG11"},
+                {GL_COMPRESSED_SIGNED_RG11_EAC,                    16, ETC2, "EAC RG11 signed"}
+        };
+
+        for (const auto &f : formats) {
+            if (f.internal_format == internal_format) {
+                return f;
+            }
+        }
+
+        std::stringstream s;
+        s << "Unsupported compressed format 0x" << std::hex << internal_format << ".";
+        throw CompressedTextureError(s.str());
+    }
+
+    inline size_t CompressedImage::block_bytes(GLenum internal_format) {
+        return format(internal_format).block_bytes;
+    }
+
+    inline bool CompressedImage::supported(GLenum internal_format) {
+        switch (format(internal_format).family) {
+            case S3TC:
+                return GLEW_EXT_texture_compression_s3tc;
+            case S3TC_SRGB:
+                return GLEW_EXT_texture_compression_s3tc && GLEW_EXT_texture_sRGB;
+            case RGTC:
+                return GLEW_VERSION_3_0 || GLEW_ARB_texture_compression_rgtc;
+            case BPTC:
+                return GLEW_VERSION_4_2 || GLEW_ARB_texture_compression_bptc;
+            case ETC2:
+                return GLEW_VERSION_4_3 || GLEW_ARB_ES3_compatibility;
+        }
+
+        return false;
+    }
+
+    inline void CompressedImage::assert_supported(GLenum internal_format) {
+        if (!supported(internal_format)) {
+            throw CompressedTextureError(std::string("The OpenGL driver doesn't support ") +
+                                         format(internal_format).name + " textures.");
+        }
+    }
+
+    inline GLenum CompressedImage::dds_format(uint32_t four_cc) {
+        switch (four_cc) {
+            case 0x31545844: // "DXT1"
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case 0x33545844: // "DXT3"
+                return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            case 0x35545844: // "DXT5"
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case 0x31495441: // "ATI1"
+            case 0x55344342: // "BC4U"
+                return GL_COMPRESSED_RED_RGTC1;
+            case 0x53344342: // "BC4S"
+                return GL_COMPRESSED_SIGNED_RED_RGTC1;
+            case 0x32495441: // "ATI2"
+            case 0x55354342: // "BC5U"
+                return GL_COMPRESSED_RG_RGTC2;
+            case 0x53354342: // "BC5S"
+                return GL_COMPRESSED_SIGNED_RG_RGTC2;
+            default:
+                std::stringstream s;
+                s << "Unsupported DDS FourCC 0x" << std::hex << four_cc << ".";
+                throw CompressedTextureError(s.str());
+        }
+    }
+
+    inline GLenum CompressedImage::dxgi_format(uint32_t dxgi_format) {
+        switch (dxgi_format) {
+            case 71:
+                return GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+            case 72:
+                return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT;
+            case 74:
+                return GL_COMPRESSED_RGBA_S3TC_DXT3_EXT;
+            case 75:
+                return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT3_EXT;
+            case 77:
+                return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            case 78:
+                return GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+            case 80:
+                return GL_COMPRESSED_RED_RGTC1;
+            case 81:
+                return GL_COMPRESSED_SIGNED_RED_RGTC1;
+            case 83:
+                return GL_COMPRESSED_RG_RGTC2;
+            case 84:
+                return GL_COMPRESSED_SIGNED_RG_RGTC2;
+            case 95:
+                return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+            case 96:
+                return GL_COMPRESSED_RGB_BPTC_SIGNED_FLOAT;
+            case 98:
+                return GL_COMPRESSED_RGBA_BPTC_UNORM;
+            case 99:
+                return GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+            default:
+                std::stringstream s;
+                s << "Unsupported DXGI format " << dxgi_format << ".";
+                throw CompressedTextureError(s.str());
+        }
+    }
+
+    inline CompressedTexture2D::CompressedTexture2D(const CompressedImage &image)
+            : _internal_format(image.internal_format()), _levels(image.levels()) {
+        CompressedImage::assert_supported(_internal_format);
+
+        if (image.layers() != 1) {
+            throw CompressedTextureError("“" + image.filename() + "” is an array, use CompressedTextureArray2D.");
+        }
+
+        _memory.resize(image.bytes());
+        glBindTexture(target(), id());
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            glCompressedTexImage2D(target(), level, _internal_format, image.width(level), image.height(level), 0,
+                                   image.level_size(level), image.data(level));
+            assertNoGLError("glCompressedTexImage2D");
+            image.release(level);
+        }
+
+        glTexParameteri(target(), GL_TEXTURE_MAX_LEVEL, _levels - 1);
+        glTexParameteri(target(), GL_TEXTURE_MIN_FILTER, _levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        assertNoGLError("glTexParameteri");
+        GPGPU_TRACE_UPLOAD("CompressedTexture2D", image.bytes());
+    }
+
+    inline CompressedTextureArray2D::CompressedTextureArray2D(const CompressedImage &image) {
+        allocate(image, image.layers());
+        upload(image, 0);
+    }
+
+    inline CompressedTextureArray2D::CompressedTextureArray2D(const std::vector<std::string> &filenames) {
+        if (filenames.empty()) {
+            throw CompressedTextureError("A texture array needs at least one file.");
+        }
+
+        for (unsigned int i = 0; i < filenames.size(); ++i) {
+            CompressedImage image(filenames[i]);
+
+            if (i == 0) {
+                allocate(image, filenames.size());
+            }
+
+            if (image.layers() != 1) {
+                throw CompressedTextureError("“" + image.filename() + "” has more than one layer.");
+            }
+
+            upload(image, i);
+        }
+    }
+
+    inline void CompressedTextureArray2D::allocate(const CompressedImage &image, unsigned int layers) {
+        _internal_format = image.internal_format();
+        _width = image.width();
+        _height = image.height();
+        _levels = image.levels();
+        CompressedImage::assert_supported(_internal_format);
+
+        _memory.resize(image.bytes() / image.layers() * layers);
+        glBindTexture(target(), id());
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            glCompressedTexImage3D(target(), level, _internal_format, image.width(level), image.height(level),
+                                   layers, 0, image.level_size(level) * layers, nullptr);
+            assertNoGLError("glCompressedTexImage3D");
+        }
+
+        glTexParameteri(target(), GL_TEXTURE_MAX_LEVEL, _levels - 1);
+        glTexParameteri(target(), GL_TEXTURE_MIN_FILTER, _levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        assertNoGLError("glTexParameteri");
+    }
+
+    inline void CompressedTextureArray2D::upload(const CompressedImage &image, unsigned int first) {
+        if (image.internal_format() != _internal_format || image.width() != _width || image.height() != _height ||
+            image.levels() != _levels) {
+            throw CompressedTextureError("“" + image.filename() + "” differs in format, size or levels.");
+        }
+
+        glBindTexture(target(), id());
+
+        for (unsigned int level = 0; level < _levels; ++level) {
+            const size_t size = image.level_size(level);
+
+            // Layers of a KTX level are back to back, DDS stores layer after layer.
+            if (image.contiguous(level)) {
+                glCompressedTexSubImage3D(target(), level, 0, 0, first, image.width(level), image.height(level),
+                                          image.layers(), _internal_format, size * image.layers(),
+                                          image.data(level));
+            } else {
+                for (unsigned int layer = 0; layer < image.layers(); ++layer) {
+                    glCompressedTexSubImage3D(target(), level, 0, 0, first + layer, image.width(level),
+                                              image.height(level), 1, _internal_format, size,
+                                              image.data(level, layer));
+                }
+            }
+
+            assertNoGLError("glCompressedTexSubImage3D");
+            image.release(level);
+        }
+
+        GPGPU_TRACE_UPLOAD("CompressedTextureArray2D", image.bytes());
+    }
+}
+
+#endif /* GPGPU_OPENGL_COMPRESSEDTEXTURE_HPP */
@@ -24,7 +24,11 @@
 #define GPGPU_OPENGL_CONTEXT_HPP
 
 #include "OpenGLObject.hpp"
+#include "Fence.hpp"
+#include "MemoryTracker.hpp"
 
+#include <list>
+#include <memory>
 #include <ostream>
 #include <GLFW/glfw3.h>
 
@@ -42,11 +46,20 @@ namespace gpgpu {
         Context();
 
         ~Context() {
+            _in_flight.clear();
             glfwTerminate();
         }
 
         void make_current() {
             glfwMakeContextCurrent(_handle);
+            MemoryTracker::current() = _memory;
+        }
+
+        /**
+         * GPU memory allocated by resources created while this context was current.
+         */
+        std::shared_ptr<MemoryTracker> memory() const {
+            return _memory;
         }
 
         std::string gl_vendor() const {
@@ -57,8 +70,27 @@ namespace gpgpu {
             return gl_query(GL_VERSION);
         }
 
+        /**
+         * Fences all commands issued so far (renders, uploads, read backs
+         * into buffers) and tracks the returned future until it completes.
+         */
+        std::shared_ptr<GpuFuture> submit();
+
+        /**
+         * Runs continuations of completed futures, never blocks.
+         *
+         * @return Number of futures still in flight.
+         */
+        size_t poll();
+
+        size_t in_flight() const {
+            return _in_flight.size();
+        }
+
     protected:
         GLFWwindow* _handle;
+        std::shared_ptr<MemoryTracker> _memory = std::make_shared<MemoryTracker>();
+        std::list<std::shared_ptr<GpuFuture>> _in_flight;
         std::string gl_query(GLenum name) const;
     };
 
@@ -88,6 +120,24 @@ namespace gpgpu {
         }
     }
 
+    inline std::shared_ptr<GpuFuture> Context::submit() {
+        auto future = std::make_shared<GpuFuture>();
+        _in_flight.push_back(future);
+        return future;
+    }
+
+    inline size_t Context::poll() {
+        for (auto it = _in_flight.begin(); it != _in_flight.end();) {
+            if ((*it)->poll()) {
+                it = _in_flight.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        return _in_flight.size();
+    }
+
     inline std::string Context::gl_query(GLenum name) const {
         auto v = glGetString(name);
         assertNoGLError("glGetString");
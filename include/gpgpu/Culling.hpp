@@ -0,0 +1,342 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_CULLING_HPP
+#define GPGPU_CULLING_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "ThreadPool.hpp"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * The six clip planes of a view projection matrix (OpenGL clip space),
+     * normalized and pointing inwards.
+     */
+    class Frustum {
+    public:
+        enum PlaneIndex {
+            Left, Right, Bottom, Top, Near, Far, Planes
+        };
+
+        explicit Frustum(const Eigen::Matrix4f &view_projection);
+
+        /**
+         * Coefficients (a, b, c, d) of a x + b y + c z + d = 0.
+         */
+        Eigen::Vector4f plane(PlaneIndex index) const {
+            return Eigen::Vector4f(_planes[index][0], _planes[index][1], _planes[index][2], _planes[index][3]);
+        }
+
+        bool intersects(const Eigen::Vector3f &center, const Eigen::Vector3f &extents, float radius = 0) const;
+
+    protected:
+        float _planes[Planes][4];
+
+        friend class FrustumCuller;
+    };
+
+    /**
+     * Bounding volumes in structure-of-arrays layout for vectorized tests.
+     * Each volume is an axis aligned box (center and half extents) grown by
+     * a radius, so boxes have radius 0 and spheres have zero extents.
+     */
+    class BoundingVolumes {
+    public:
+        size_t add_box(const Eigen::Vector3f &center, const Eigen::Vector3f &extents) {
+            return add(center, extents, 0);
+        }
+
+        size_t add_sphere(const Eigen::Vector3f &center, float radius) {
+            return add(center, Eigen::Vector3f::Zero(), radius);
+        }
+
+        size_t add(const Eigen::Vector3f &center, const Eigen::Vector3f &extents, float radius);
+
+        /**
+         * Moves volume `index`, e.g. for animated objects.
+         */
+        void set_center(size_t index, const Eigen::Vector3f &center) {
+            _x[index] = center.x();
+            _y[index] = center.y();
+            _z[index] = center.z();
+        }
+
+        void reserve(size_t size);
+
+        void clear();
+
+        size_t size() const {
+            return _x.size();
+        }
+
+    protected:
+        std::vector<float> _x, _y, _z;
+        std::vector<float> _ex, _ey, _ez;
+        std::vector<float> _radius;
+
+        friend class FrustumCuller;
+    };
+
+    /**
+     * Tests bounding volumes against a frustum, four at a time with SSE
+     * and in chunks across worker threads. Volumes crossing a plane count
+     * as visible.
+     */
+    class FrustumCuller {
+    public:
+        /**
+         * @param threads Number of workers, 0 selects all but one hardware thread.
+         * @param chunk Volumes tested per task, smaller inputs are culled on the calling thread.
+         */
+        explicit FrustumCuller(unsigned int threads = 0, size_t chunk = 65536);
+
+        /**
+         * Replaces `visible` with the ascending indices of the volumes inside
+         * or intersecting the frustum.
+         */
+        void cull(const Frustum &frustum, const BoundingVolumes &volumes, std::vector<uint32_t> &visible);
+
+        /**
+         * Culls volumes [begin, end) on the calling thread.
+         *
+         * @param visible Receives up to end - begin indices.
+         * @return Number of visible volumes written.
+         */
+        static size_t cull_range(const Frustum &frustum, const BoundingVolumes &volumes,
+                                 size_t begin, size_t end, uint32_t *visible);
+
+    protected:
+        size_t _chunk;
+        std::unique_ptr<ThreadPool> _pool;
+        std::vector<size_t> _counts;
+    };
+
+
+    /*
+     * Definition
+     */
+    inline Frustum::Frustum(const Eigen::Matrix4f &m) {
+        // Gribb & Hartmann: combinations of the matrix' fourth row with the others.
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                _planes[2 * i][j] = m(3, j) + m(i, j);
+                _planes[2 * i + 1][j] = m(3, j) - m(i, j);
+            }
+        }
+
+        for (auto &plane : _planes) {
+            const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+            if (length > 0) {
+                for (auto &coefficient : plane) {
+                    coefficient /= length;
+                }
+            }
+        }
+    }
+
+    inline bool Frustum::intersects(const Eigen::Vector3f &center, const Eigen::Vector3f &extents,
+                                    float radius) const {
+        for (auto &p : _planes) {
+            const float distance = p[0] * center.x() + p[1] * center.y() + p[2] * center.z() + p[3];
+            const float reach = std::abs(p[0]) * extents.x() + std::abs(p[1]) * extents.y() +
+                                std::abs(p[2]) * extents.z() + radius;
+
+            if (distance < -reach) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    inline size_t BoundingVolumes::add(const Eigen::Vector3f &center, const Eigen::Vector3f &extents,
+                                       float radius) {
+        _x.push_back(center.x());
+        _y.push_back(center.y());
+        _z.push_back(center.z());
+        _ex.push_back(extents.x());
+        _ey.push_back(extents.y());
+        _ez.push_back(extents.z());
+        _radius.push_back(radius);
+        return _x.size() - 1;
+    }
+
+    inline void BoundingVolumes::reserve(size_t size) {
+        for (auto v : {&_x, &_y, &_z, &_ex, &_ey, &_ez, &_radius}) {
+            v->reserve(size);
+        }
+    }
+
+    inline void BoundingVolumes::clear() {
+        for (auto v : {&_x, &_y, &_z, &_ex, &_ey, &_ez, &_radius}) {
+            v->clear();
+        }
+    }
+
+    inline FrustumCuller::FrustumCuller(unsigned int threads, size_t chunk)
+            : _chunk(chunk < 4 ? 4 : chunk) {
+        if (threads == 0) {
+            threads = ThreadPool::default_thread_count();
+        }
+
+        if (threads > 1) {
+            _pool.reset(new ThreadPool(threads));
+        }
+    }
+
+    inline void FrustumCuller::cull(const Frustum &frustum, const BoundingVolumes &volumes,
+                                    std::vector<uint32_t> &visible) {
+        const size_t n = volumes.size();
+        visible.resize(n);
+
+        if (!_pool || n <= _chunk) {
+            visible.resize(cull_range(frustum, volumes, 0, n, visible.data()));
+            return;
+        }
+
+        /*
+         * Every chunk writes to its own range of `visible`, the results are
+         * compacted afterwards to keep the indices in order.
+         */
+        const size_t chunks = (n + _chunk - 1) / _chunk;
+        _counts.assign(chunks, 0);
+
+        for (size_t i = 0; i < chunks; ++i) {
+            _pool->submit([this, i, n, &frustum, &volumes, &visible]() {
+                const size_t begin = i * _chunk;
+                const size_t end = std::min(begin + _chunk, n);
+                _counts[i] = cull_range(frustum, volumes, begin, end, visible.data() + begin);
+            });
+        }
+
+        _pool->wait();
+
+        size_t size = _counts[0];
+
+        for (size_t i = 1; i < chunks; ++i) {
+            const uint32_t *chunk = visible.data() + i * _chunk;
+            std::copy(chunk, chunk + _counts[i], visible.data() + size);
+            size += _counts[i];
+        }
+
+        visible.resize(size);
+    }
+
+    inline size_t FrustumCuller::cull_range(const Frustum &frustum, const BoundingVolumes &volumes,
+                                            size_t begin, size_t end, uint32_t *visible) {
+        const float *x = volumes._x.data();
+        const float *y = volumes._y.data();
+        const float *z = volumes._z.data();
+        const float *ex = volumes._ex.data();
+        const float *ey = volumes._ey.data();
+        const float *ez = volumes._ez.data();
+        const float *r = volumes._radius.data();
+
+        size_t count = 0;
+        size_t i = begin;
+
+#if defined(__SSE2__)
+        __m128 planes[Frustum::Planes][4];
+        __m128 abs_normals[Frustum::Planes][3];
+
+        for (int p = 0; p < Frustum::Planes; ++p) {
+            for (int j = 0; j < 4; ++j) {
+                planes[p][j] = _mm_set1_ps(frustum._planes[p][j]);
+            }
+
+            for (int j = 0; j < 3; ++j) {
+                abs_normals[p][j] = _mm_set1_ps(std::abs(frustum._planes[p][j]));
+            }
+        }
+
+        for (; i + 4 <= end; i += 4) {
+            const __m128 vx = _mm_loadu_ps(x + i);
+            const __m128 vy = _mm_loadu_ps(y + i);
+            const __m128 vz = _mm_loadu_ps(z + i);
+            const __m128 vex = _mm_loadu_ps(ex + i);
+            const __m128 vey = _mm_loadu_ps(ey + i);
+            const __m128 vez = _mm_loadu_ps(ez + i);
+            const __m128 vr = _mm_loadu_ps(r + i);
+
+            __m128 outside = _mm_setzero_ps();
+
+            for (int p = 0; p < Frustum::Planes; ++p) {
+                const __m128 distance = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(planes[p][0], vx), _mm_mul_ps(planes[p][1], vy)),
+                        _mm_add_ps(_mm_mul_ps(planes[p][2], vz), planes[p][3]));
+                const __m128 reach = _mm_add_ps(
+                        _mm_add_ps(_mm_mul_ps(abs_normals[p][0], vex), _mm_mul_ps(abs_normals[p][1], vey)),
+                        _mm_add_ps(_mm_mul_ps(abs_normals[p][2], vez), vr));
+
+                // distance < -reach  <=>  distance + reach < 0
+                outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, reach), _mm_setzero_ps()));
+            }
+
+            int inside = ~_mm_movemask_ps(outside) & 0xf;
+
+            while (inside) {
+                const int lane = __builtin_ctz(inside);
+                visible[count++] = static_cast<uint32_t>(i + lane);
+                inside &= inside - 1;
+            }
+        }
+#endif
+
+        for (; i < end; ++i) {
+            bool inside = true;
+
+            for (auto &p : frustum._planes) {
+                const float distance = p[0] * x[i] + p[1] * y[i] + p[2] * z[i] + p[3];
+                const float reach = std::abs(p[0]) * ex[i] + std::abs(p[1]) * ey[i] + std::abs(p[2]) * ez[i] + r[i];
+
+                if (distance + reach < 0) {
+                    inside = false;
+                    break;
+                }
+            }
+
+            if (inside) {
+                visible[count++] = static_cast<uint32_t>(i);
+            }
+        }
+
+        return count;
+    }
+}
+
+#endif /* GPGPU_CULLING_HPP */
@@ -0,0 +1,173 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_FENCE_HPP
+#define GPGPU_OPENGL_FENCE_HPP
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "OpenGLObject.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Sync object signaled once all OpenGL commands issued before its
+     * creation have completed on the GPU.
+     */
+    class Fence : public OpenGLObject {
+    public:
+        Fence();
+
+        ~Fence();
+
+        Fence(const Fence &) = delete;
+
+        Fence &operator=(const Fence &) = delete;
+
+        /**
+         * Non-blocking, flushes pending commands the first time so the fence can signal at all.
+         */
+        bool ready();
+
+        /**
+         * @return False if the timeout expired before the fence was signaled.
+         */
+        bool wait(std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max());
+
+    protected:
+        GLsync _sync;
+        bool _signaled = false;
+        bool _flushed = false;
+
+        bool client_wait(GLuint64 timeout);
+    };
+
+    /**
+     * Completion handle of submitted GPU work, see Context::submit().
+     * Continuations run on the thread owning the context, either from
+     * then() if the work has already completed or from Context::poll().
+     */
+    class GpuFuture {
+    public:
+        typedef std::function<void()> Continuation;
+
+        GpuFuture() : _fence(new Fence()) {
+
+        }
+
+        bool ready() {
+            return _fence->ready();
+        }
+
+        bool wait(std::chrono::nanoseconds timeout = std::chrono::nanoseconds::max()) {
+            return _fence->wait(timeout) && (run(), true);
+        }
+
+        void then(Continuation continuation);
+
+        /**
+         * Runs pending continuations if the work completed.
+         *
+         * @return True once completed and all continuations ran.
+         */
+        bool poll() {
+            return ready() && (run(), true);
+        }
+
+    protected:
+        std::unique_ptr<Fence> _fence;
+        std::vector<Continuation> _continuations;
+
+        void run();
+    };
+
+
+    /*
+     * Definition
+     */
+    inline Fence::Fence() {
+        _sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        assertNoGLError("glFenceSync");
+    }
+
+    inline Fence::~Fence() {
+        glDeleteSync(_sync);
+    }
+
+    inline bool Fence::ready() {
+        return _signaled || client_wait(0);
+    }
+
+    inline bool Fence::wait(std::chrono::nanoseconds timeout) {
+        if (_signaled) {
+            return true;
+        }
+
+        const auto ns = timeout.count() < 0 ? 0 : timeout.count();
+        return client_wait(static_cast<GLuint64>(ns));
+    }
+
+    inline bool Fence::client_wait(GLuint64 timeout) {
+        GLbitfield flags = 0;
+
+        if (!_flushed) {
+            flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            _flushed = true;
+        }
+
+        const GLenum status = glClientWaitSync(_sync, flags, timeout);
+
+        if (status == GL_WAIT_FAILED) {
+            assertNoGLError("glClientWaitSync");
+            throw OpenGLError("glClientWaitSync failed.");
+        }
+
+        _signaled = status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+        return _signaled;
+    }
+
+    inline void GpuFuture::then(Continuation continuation) {
+        _continuations.push_back(std::move(continuation));
+
+        if (ready()) {
+            run();
+        }
+    }
+
+    inline void GpuFuture::run() {
+        // Continuations may attach further ones, which then run right away.
+        std::vector<Continuation> continuations;
+        std::swap(continuations, _continuations);
+
+        for (auto &c : continuations) {
+            c();
+        }
+    }
+}
+
+#endif /* GPGPU_OPENGL_FENCE_HPP */
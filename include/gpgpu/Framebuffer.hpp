@@ -28,6 +28,7 @@
 #include <stdexcept>
 
 #include "OpenGLObject.hpp"
+#include "MemoryTracker.hpp"
 #include "Texture.hpp"
 
 namespace gpgpu {
@@ -41,28 +42,55 @@ namespace gpgpu {
         Framebuffer(unsigned int width, unsigned int height, bool use_depth_test = false)
                 : _width(width), _height(height), _use_depth_test(use_depth_test) {
 
+            // Reserve the budget first, nothing is created yet if it's exceeded.
+            if (_use_depth_test) {
+                _depth_memory.resize(size_t(_width) * _height * Texture::texel_size(GL_DEPTH_COMPONENT32F));
+            }
+
             glGenFramebuffers(1, &_id);
             assertNoGLError("glGenFramebuffers");
 
-            glBindFramebuffer(GL_FRAMEBUFFER, _id);
-            assertNoGLError("glBindFramebuffer");
-
-            if (_use_depth_test) {
-                glGenRenderbuffers(1, &_depth_buffer);
-                glBindRenderbuffer(GL_RENDERBUFFER, _depth_buffer);
-                assertNoGLError("glBindRenderbuffer");
-
-                glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, _width, _height);
-                assertNoGLError("glRenderbufferStorage");
+            try {
+                glBindFramebuffer(GL_FRAMEBUFFER, _id);
+                assertNoGLError("glBindFramebuffer");
+
+                if (_use_depth_test) {
+                    glGenRenderbuffers(1, &_depth_buffer);
+                    glBindRenderbuffer(GL_RENDERBUFFER, _depth_buffer);
+                    assertNoGLError("glBindRenderbuffer");
+
+                    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT32F, _width, _height);
+                    assertNoGLError("glRenderbufferStorage");
+
+                    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_buffer);
+                    assertNoGLError("glFramebufferRenderbuffer");
+                }
+            } catch (...) {
+                // The destructor doesn't run for a throwing constructor.
+                if (_depth_buffer != 0) {
+                    glDeleteRenderbuffers(1, &_depth_buffer);
+                }
+
+                glDeleteFramebuffers(1, &_id);
+                throw;
+            }
+        }
 
-                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, _depth_buffer);
-                assertNoGLError("glFramebufferRenderbuffer");
+        ~Framebuffer() {
+            if (_depth_buffer != 0) {
+                glDeleteRenderbuffers(1, &_depth_buffer);
             }
+
+            glDeleteFramebuffers(1, &_id);
         }
 
+        Framebuffer(const Framebuffer &) = delete;
+
+        Framebuffer &operator=(const Framebuffer &) = delete;
+
         void bind() {
-            if (_color_attachments.size() == 0) {
-                throw FramebufferError("No color attachments, nothing to draw to.");
+            if (_color_attachments.size() == 0 && !_depth_attachment) {
+                throw FramebufferError("No color or depth attachments, nothing to draw to.");
             }
 
             glBindFramebuffer(GL_FRAMEBUFFER, _id);
@@ -75,26 +103,44 @@ namespace gpgpu {
             glViewport(0, 0, _width, _height);
 
             /*
-             * Add color attachments as draw buffers.
+             * Add color attachments as draw buffers, a depth-only pass draws to none.
              */
             const unsigned int size = _color_attachments.size();
-            GLenum parameter[size];
 
-            for (unsigned int i = 0; i < size; ++i) {
-                parameter[i] = GL_COLOR_ATTACHMENT0 + i;
-            }
+            if (size == 0) {
+                glDrawBuffer(GL_NONE);
+                glReadBuffer(GL_NONE);
+                assertNoGLError("glDrawBuffer");
+            } else {
+                std::vector<GLenum> parameter(size);
 
-            glDrawBuffers(size, parameter);
-            assertNoGLError("glDrawBuffers");
+                for (unsigned int i = 0; i < size; ++i) {
+                    parameter[i] = GL_COLOR_ATTACHMENT0 + i;
+                }
+
+                glDrawBuffers(size, parameter.data());
+                assertNoGLError("glDrawBuffers");
+            }
 
             if (_use_depth_test) {
                 glEnable(GL_DEPTH_TEST);
-                glClear(GL_DEPTH_BUFFER_BIT);
+                glDepthMask(GL_TRUE);
+                glClear(_depth_stencil ? GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT : GL_DEPTH_BUFFER_BIT);
             } else {
                 glDisable(GL_DEPTH_TEST);
             }
 
-            glClear(GL_COLOR_BUFFER_BIT);
+            if (size > 0) {
+                glClear(GL_COLOR_BUFFER_BIT);
+            }
+        }
+
+        /**
+         * Groups the depth buffer's memory under `label` in MemoryTracker
+         * statistics, attached textures are labeled on their own.
+         */
+        void label(const std::string &label) {
+            _depth_memory.label(label);
         }
 
         void set_color_attachment(std::shared_ptr <Texture> texture, unsigned int id) {
@@ -111,14 +157,55 @@ namespace gpgpu {
             assertNoGLError("glFramebufferTextureLayer");
         }
 
+        /**
+         * Renders depth into a texture instead of the private renderbuffer,
+         * which makes it available for sampling and read back. Depth-stencil
+         * formats are attached as depth and stencil. Enables the depth test.
+         *
+         * Without color attachments the framebuffer runs depth-only passes.
+         */
+        void set_depth_attachment(std::shared_ptr <Texture2D> texture) {
+            GLint internalFormat;
+            texture->bind();
+            glGetTexLevelParameteriv(texture->target(), 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            assertNoGLError("glGetTexLevelParameteriv");
+
+            _depth_stencil = internalFormat == GL_DEPTH_STENCIL || internalFormat == GL_DEPTH24_STENCIL8 ||
+                             internalFormat == GL_DEPTH32F_STENCIL8;
+
+            glBindFramebuffer(GL_FRAMEBUFFER, _id);
+
+            if (_depth_buffer != 0) {
+                glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, 0);
+                glDeleteRenderbuffers(1, &_depth_buffer);
+                _depth_buffer = 0;
+                _depth_memory.resize(0);
+            }
+
+            glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                   _depth_stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT,
+                                   texture->target(), texture->id(), 0);
+            assertNoGLError("glFramebufferTexture2D");
+
+            _depth_attachment = texture;
+            _use_depth_test = true;
+        }
+
+        std::shared_ptr <Texture2D> depth_attachment() const {
+            return _depth_attachment;
+        }
+
     private:
         unsigned int _width;
         unsigned int _height;
         bool _use_depth_test;
+        bool _depth_stencil = false;
         std::vector <std::shared_ptr<Texture>> _color_attachments;
+        std::shared_ptr <Texture2D> _depth_attachment;
 
         GLuint _id;
-        GLuint _depth_buffer;
+        GLuint _depth_buffer = 0;
+        MemoryAllocation _depth_memory{MemoryTracker::RenderbufferMemory};
 
         void store_color_attachment(std::shared_ptr <Texture> texture, unsigned int id) {
             if (id < _color_attachments.size()) {
@@ -0,0 +1,705 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_IMAGEKERNELS_HPP
+#define GPGPU_OPENGL_IMAGEKERNELS_HPP
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Dense>
+#include <OpenImageIO/imagebuf.h>
+
+#include "Buffer.hpp"
+#include "Framebuffer.hpp"
+#include "Program.hpp"
+#include "ShaderCache.hpp"
+#include "Texture.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class ImageKernelError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Per-pixel operation applied at the end of a pass.
+     */
+    struct PointOperation {
+        enum Type {
+            Affine,
+            Threshold,
+            ToLinear,
+            ToSRGB
+        };
+
+        Type type;
+
+        /**
+         * Column-major 4x4 matrix and offset of Affine, threshold of Threshold.
+         */
+        float matrix[16];
+        float vector[4];
+    };
+
+    /**
+     * One full-screen draw from a source texture into a target texture.
+     */
+    struct ImagePass {
+        enum Kernel {
+            Bilinear,
+            Convolve,
+            Lanczos
+        };
+
+        Kernel kernel;
+        bool horizontal;
+
+        /**
+         * Target size, 0 keeps the source's size.
+         */
+        unsigned int width;
+        unsigned int height;
+
+        std::vector<float> weights;
+        std::vector<PointOperation> epilogue;
+    };
+
+    /**
+     * Chain of image kernels, run by ImageKernels. Building a pipeline
+     * makes no OpenGL calls.
+     *
+     * Per-pixel operations (color matrices, scale and bias, thresholds,
+     * sRGB conversions) don't get passes of their own, they run at the end
+     * of the preceding pass, and consecutive affine operations are folded
+     * into one matrix. A separable convolution is two passes, so is a
+     * Lanczos resize, a bilinear resize is one.
+     */
+    class ImagePipeline {
+    public:
+        enum Filter {
+            Bilinear,
+
+            /**
+             * Lanczos with three lobes, widened when downscaling to avoid aliasing.
+             */
+            Lanczos3
+        };
+
+        /**
+         * Convolves with the outer product of two kernels of odd length,
+         * an empty kernel skips its direction.
+         */
+        ImagePipeline &convolve(const std::vector<float> &horizontal, const std::vector<float> &vertical);
+
+        ImagePipeline &gaussian_blur(float sigma);
+
+        ImagePipeline &resize(unsigned int width, unsigned int height, Filter filter = Bilinear);
+
+        /**
+         * color = matrix * color + offset, on RGBA.
+         */
+        ImagePipeline &color_matrix(const Eigen::Matrix4f &matrix,
+                                    const Eigen::Vector4f &offset = Eigen::Vector4f::Zero());
+
+        /**
+         * rgb = rgb * scale + bias, alpha is kept.
+         */
+        ImagePipeline &scale_bias(float scale, float bias);
+
+        /**
+         * Rec. 709 luma into all color channels.
+         */
+        ImagePipeline &grayscale();
+
+        /**
+         * Color channels become 1 at or above `value`, 0 below.
+         */
+        ImagePipeline &threshold(float value);
+
+        ImagePipeline &srgb_to_linear();
+
+        ImagePipeline &linear_to_srgb();
+
+        const std::vector<ImagePass> &passes() const {
+            return _passes;
+        }
+
+    protected:
+        std::vector<ImagePass> _passes;
+
+        ImagePass &add_pass(ImagePass::Kernel kernel, bool horizontal = false,
+                            unsigned int width = 0, unsigned int height = 0);
+
+        void pointwise(const PointOperation &operation);
+    };
+
+    /**
+     * Runs ImagePipelines on the current context. Intermediate results
+     * stay on the GPU in RGBA float textures that are recycled between
+     * passes and runs, programs are compiled once per kernel variant.
+     *
+     * Leaves one of its framebuffers bound.
+     */
+    class ImageKernels : public OpenGLObject {
+    public:
+        ImageKernels();
+
+        /**
+         * Uploads `input` (1 to 4 channels of 8/16 bit, half or float
+         * values), runs the pipeline and reads the result back with the
+         * same channels and orientation.
+         *
+         * @param format Pixel type of the result, UNKNOWN keeps the input's.
+         */
+        std::shared_ptr<OpenImageIO::ImageBuf> run(const ImagePipeline &pipeline,
+                                                   const OpenImageIO::ImageBuf &input,
+                                                   OpenImageIO::TypeDesc format = OpenImageIO::TypeDesc::UNKNOWN);
+
+        /**
+         * Runs the pipeline on a texture and returns the result as an
+         * RGBA32F texture, for chaining into further GPU work.
+         */
+        std::shared_ptr<Texture2D> run(const ImagePipeline &pipeline, std::shared_ptr<Texture2D> input);
+
+        ShaderCache &cache() {
+            return _cache;
+        }
+
+        /**
+         * Frees the recycled textures and framebuffers.
+         */
+        void clear();
+
+    protected:
+        ShaderCache _cache;
+        ShaderTemplate _vertex;
+        ShaderTemplate _fragment;
+        std::shared_ptr<ArrayBuffer> _triangle;
+
+        std::map<std::pair<unsigned int, unsigned int>, std::vector<std::shared_ptr<Texture2D>>> _textures;
+        std::map<std::pair<unsigned int, unsigned int>, std::unique_ptr<Framebuffer>> _framebuffers;
+
+        std::shared_ptr<Texture2D> acquire(unsigned int width, unsigned int height);
+
+        void release(std::shared_ptr<Texture2D> texture);
+
+        void apply(const ImagePass &pass, std::shared_ptr<Texture2D> source, unsigned int width,
+                   unsigned int height, std::shared_ptr<Texture2D> target, unsigned int target_width,
+                   unsigned int target_height);
+
+        static ShaderDefines defines(const ImagePass &pass);
+
+        void set_swizzle(Texture2D &texture, int channels);
+    };
+
+
+    /*
+     * Definition
+     */
+    inline ImagePass &ImagePipeline::add_pass(ImagePass::Kernel kernel, bool horizontal, unsigned int width,
+                                              unsigned int height) {
+        ImagePass pass;
+        pass.kernel = kernel;
+        pass.horizontal = horizontal;
+        pass.width = width;
+        pass.height = height;
+
+        _passes.push_back(std::move(pass));
+        return _passes.back();
+    }
+
+    inline ImagePipeline &ImagePipeline::convolve(const std::vector<float> &horizontal,
+                                                  const std::vector<float> &vertical) {
+        for (auto kernel : {&horizontal, &vertical}) {
+            if (kernel->size() % 2 == 0 && !kernel->empty()) {
+                throw ImageKernelError("Convolution kernels need an odd number of weights.");
+            }
+        }
+
+        if (!horizontal.empty()) {
+            add_pass(ImagePass::Convolve, true).weights = horizontal;
+        }
+
+        if (!vertical.empty()) {
+            add_pass(ImagePass::Convolve, false).weights = vertical;
+        }
+
+        return *this;
+    }
+
+    inline ImagePipeline &ImagePipeline::gaussian_blur(float sigma) {
+        if (sigma <= 0) {
+            throw ImageKernelError("Gaussian blur needs a positive sigma.");
+        }
+
+        const int radius = std::max(1, static_cast<int>(std::ceil(3 * sigma)));
+        std::vector<float> weights(2 * radius + 1);
+        float sum = 0;
+
+        for (int i = -radius; i <= radius; ++i) {
+            weights[i + radius] = std::exp(-(i * i) / (2 * sigma * sigma));
+            sum += weights[i + radius];
+        }
+
+        for (auto &w : weights) {
+            w /= sum;
+        }
+
+        return convolve(weights, weights);
+    }
+
+    inline ImagePipeline &ImagePipeline::resize(unsigned int width, unsigned int height, Filter filter) {
+        if (width == 0 || height == 0) {
+            throw ImageKernelError("Can't resize to an empty image.");
+        }
+
+        if (filter == Lanczos3) {
+            add_pass(ImagePass::Lanczos, true, width, 0);
+            add_pass(ImagePass::Lanczos, false, width, height);
+        } else {
+            add_pass(ImagePass::Bilinear, false, width, height);
+        }
+
+        return *this;
+    }
+
+    inline ImagePipeline &ImagePipeline::color_matrix(const Eigen::Matrix4f &matrix, const Eigen::Vector4f &offset) {
+        PointOperation operation;
+        operation.type = PointOperation::Affine;
+        Eigen::Map<Eigen::Matrix4f>(operation.matrix) = matrix;
+        Eigen::Map<Eigen::Vector4f>(operation.vector) = offset;
+
+        pointwise(operation);
+        return *this;
+    }
+
+    inline ImagePipeline &ImagePipeline::scale_bias(float scale, float bias) {
+        Eigen::Matrix4f matrix = Eigen::Matrix4f::Identity() * scale;
+        matrix(3, 3) = 1;
+
+        return color_matrix(matrix, Eigen::Vector4f(bias, bias, bias, 0));
+    }
+
+    inline ImagePipeline &ImagePipeline::grayscale() {
+        Eigen::Matrix4f matrix = Eigen::Matrix4f::Zero();
+        matrix.block<3, 3>(0, 0).rowwise() = Eigen::RowVector3f(0.2126f, 0.7152f, 0.0722f);
+        matrix(3, 3) = 1;
+
+        return color_matrix(matrix);
+    }
+
+    inline ImagePipeline &ImagePipeline::threshold(float value) {
+        PointOperation operation;
+        operation.type = PointOperation::Threshold;
+        Eigen::Map<Eigen::Vector4f>(operation.vector).setConstant(value);
+
+        pointwise(operation);
+        return *this;
+    }
+
+    inline ImagePipeline &ImagePipeline::srgb_to_linear() {
+        PointOperation operation;
+        operation.type = PointOperation::ToLinear;
+
+        pointwise(operation);
+        return *this;
+    }
+
+    inline ImagePipeline &ImagePipeline::linear_to_srgb() {
+        PointOperation operation;
+        operation.type = PointOperation::ToSRGB;
+
+        pointwise(operation);
+        return *this;
+    }
+
+    inline void ImagePipeline::pointwise(const PointOperation &operation) {
+        // A per-pixel operation at the start needs a pass of its own to run in.
+        if (_passes.empty()) {
+            add_pass(ImagePass::Bilinear);
+        }
+
+        auto &epilogue = _passes.back().epilogue;
+
+        if (operation.type == PointOperation::Affine && !epilogue.empty() &&
+            epilogue.back().type == PointOperation::Affine) {
+            // M2 (M1 c + v1) + v2 = (M2 M1) c + (M2 v1 + v2)
+            Eigen::Map<Eigen::Matrix4f> m1(epilogue.back().matrix);
+            Eigen::Map<Eigen::Vector4f> v1(epilogue.back().vector);
+            Eigen::Map<const Eigen::Matrix4f> m2(operation.matrix);
+            Eigen::Map<const Eigen::Vector4f> v2(operation.vector);
+
+            v1 = (m2 * v1 + v2).eval();
+            m1 = (m2 * m1).eval();
+            return;
+        }
+
+        epilogue.push_back(operation);
+    }
+
+    inline ImageKernels::ImageKernels()
+            : _vertex(Shader::Vertex, R"(#version 130
+
+in vec2 position;
+
+void main() {
+    gl_Position = vec4(position, 0.0, 1.0);
+}
+)"),
+              _fragment(Shader::Fragment, R"(#version 130
+
+uniform sampler2D u_source;
+out vec4 color;
+
+#if OPERATIONS > 0
+uniform mat4 u_matrix[OPERATIONS];
+uniform vec4 u_vector[OPERATIONS];
+#endif
+
+#define AFFINE(c, i) c = u_matrix[i] * c + u_vector[i];
+#define THRESHOLD(c, i) c.rgb = step(u_vector[i].rgb, c.rgb);
+#define TO_LINEAR(c) c.rgb = mix(c.rgb / 12.92, pow((max(c.rgb, 0.0) + 0.055) / 1.055, vec3(2.4)), step(0.04045, c.rgb));
+#define TO_SRGB(c) c.rgb = mix(c.rgb * 12.92, 1.055 * pow(max(c.rgb, 0.0), vec3(1.0 / 2.4)) - 0.055, step(0.0031308, c.rgb));
+
+// Clamps to the edge, independent of the texture's filter and wrap state.
+vec4 fetch(ivec2 p) {
+    return texelFetch(u_source, clamp(p, ivec2(0), textureSize(u_source, 0) - 1), 0);
+}
+
+#if defined(CONVOLVE)
+uniform float u_weights[TAPS];
+
+vec4 kernel() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    vec4 sum = vec4(0.0);
+
+    for (int i = 0; i < TAPS; ++i) {
+        sum += u_weights[i] * fetch(p + DIRECTION * (i - TAPS / 2));
+    }
+
+    return sum;
+}
+#elif defined(LANCZOS)
+// Source pixels per target pixel along DIRECTION.
+uniform float u_scale;
+
+float lanczos(float x) {
+    if (abs(x) < 1e-5) {
+        return 1.0;
+    }
+
+    if (abs(x) >= 3.0) {
+        return 0.0;
+    }
+
+    float px = 3.14159265 * x;
+    return 3.0 * sin(px) * sin(px / 3.0) / (px * px);
+}
+
+vec4 kernel() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 other = p * (ivec2(1) - DIRECTION);
+
+    float center = dot(gl_FragCoord.xy, vec2(DIRECTION)) * u_scale;
+    float stretch = max(u_scale, 1.0);
+    int first = int(floor(center - 3.0 * stretch));
+    int last = int(ceil(center + 3.0 * stretch));
+
+    vec4 sum = vec4(0.0);
+    float total = 0.0;
+
+    for (int i = first; i <= last; ++i) {
+        float w = lanczos((float(i) + 0.5 - center) / stretch);
+        sum += w * fetch(other + DIRECTION * i);
+        total += w;
+    }
+
+    return sum / total;
+}
+#else
+// Source pixels per target pixel.
+uniform vec2 u_scale;
+
+vec4 kernel() {
+    vec2 c = gl_FragCoord.xy * u_scale - 0.5;
+    ivec2 i = ivec2(floor(c));
+    vec2 f = c - floor(c);
+
+    return mix(mix(fetch(i), fetch(i + ivec2(1, 0)), f.x),
+               mix(fetch(i + ivec2(0, 1)), fetch(i + ivec2(1, 1)), f.x), f.y);
+}
+#endif
+
+void main() {
+    color = kernel();
+    EPILOGUE(color)
+}
+)") {
+        // One triangle covering the viewport.
+        const float triangle[] = {-1, -1, 3, -1, -1, 3};
+        _triangle = std::make_shared<ArrayBuffer>();
+        _triangle->data(3, 2, triangle);
+    }
+
+    inline ShaderDefines ImageKernels::defines(const ImagePass &pass) {
+        ShaderDefines defines;
+
+        switch (pass.kernel) {
+            case ImagePass::Convolve:
+                defines.define("CONVOLVE").define("TAPS", static_cast<int>(pass.weights.size()));
+                break;
+            case ImagePass::Lanczos:
+                defines.define("LANCZOS");
+                break;
+            default:
+                break;
+        }
+
+        if (pass.kernel != ImagePass::Bilinear) {
+            defines.define("DIRECTION", pass.horizontal ? "ivec2(1, 0)" : "ivec2(0, 1)");
+        }
+
+        std::stringstream epilogue;
+
+        for (size_t i = 0; i < pass.epilogue.size(); ++i) {
+            switch (pass.epilogue[i].type) {
+                case PointOperation::Affine:
+                    epilogue << "AFFINE(c, " << i << ") ";
+                    break;
+                case PointOperation::Threshold:
+                    epilogue << "THRESHOLD(c, " << i << ") ";
+                    break;
+                case PointOperation::ToLinear:
+                    epilogue << "TO_LINEAR(c) ";
+                    break;
+                case PointOperation::ToSRGB:
+                    epilogue << "TO_SRGB(c) ";
+                    break;
+            }
+        }
+
+        defines.define("OPERATIONS", static_cast<int>(pass.epilogue.size()));
+        defines.define("EPILOGUE(c)", epilogue.str());
+        return defines;
+    }
+
+    inline void ImageKernels::apply(const ImagePass &pass, std::shared_ptr<Texture2D> source, unsigned int width,
+                                    unsigned int height, std::shared_ptr<Texture2D> target,
+                                    unsigned int target_width, unsigned int target_height) {
+        auto &framebuffer = _framebuffers[std::make_pair(target_width, target_height)];
+
+        if (!framebuffer) {
+            framebuffer.reset(new Framebuffer(target_width, target_height));
+        }
+
+        framebuffer->set_color_attachment(target, 0);
+        framebuffer->bind();
+
+        auto program = _cache.program({&_vertex, &_fragment}, defines(pass));
+        program->use();
+        program->uniform("u_source", source);
+
+        switch (pass.kernel) {
+            case ImagePass::Convolve:
+                program->setUniformLocation(program->uniformLocation("u_weights"), 1, 1, pass.weights.data(),
+                                            pass.weights.size());
+                break;
+            case ImagePass::Lanczos:
+                program->uniform("u_scale", pass.horizontal ? float(width) / target_width
+                                                            : float(height) / target_height);
+                break;
+            default:
+                program->uniform("u_scale", Eigen::Vector2f(float(width) / target_width,
+                                                            float(height) / target_height));
+                break;
+        }
+
+        if (!pass.epilogue.empty()) {
+            // Operations without uniforms leave array entries unused, the compiler may drop whole arrays.
+            std::vector<float> matrices, vectors;
+
+            for (const auto &operation : pass.epilogue) {
+                matrices.insert(matrices.end(), operation.matrix, operation.matrix + 16);
+                vectors.insert(vectors.end(), operation.vector, operation.vector + 4);
+            }
+
+            const GLint matrix = glGetUniformLocation(program->id(), "u_matrix");
+            const GLint vector = glGetUniformLocation(program->id(), "u_vector");
+            assertNoGLError("glGetUniformLocation");
+
+            if (matrix >= 0) {
+                program->setUniformLocation(matrix, 4, 4, matrices.data(), pass.epilogue.size());
+            }
+
+            if (vector >= 0) {
+                program->setUniformLocation(vector, 4, 1, vectors.data(), pass.epilogue.size());
+            }
+        }
+
+        program->attribute("position", _triangle);
+        program->enableAttributes();
+
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        assertNoGLError("glDrawArrays");
+
+        program->disableAttributesAndClear();
+    }
+
+    inline std::shared_ptr<Texture2D> ImageKernels::run(const ImagePipeline &pipeline,
+                                                        std::shared_ptr<Texture2D> input) {
+        input->bind();
+        auto s = input->size();
+        unsigned int width = s.width;
+        unsigned int height = s.height;
+
+        std::vector<ImagePass> copy(1);
+        copy.front().kernel = ImagePass::Bilinear;
+        copy.front().horizontal = false;
+        copy.front().width = copy.front().height = 0;
+
+        const auto &passes = pipeline.passes().empty() ? copy : pipeline.passes();
+        auto source = input;
+
+        for (const auto &pass : passes) {
+            const unsigned int target_width = pass.width ? pass.width : width;
+            const unsigned int target_height = pass.height ? pass.height : height;
+
+            auto target = acquire(target_width, target_height);
+            apply(pass, source, width, height, target, target_width, target_height);
+
+            if (source != input) {
+                release(source);
+            }
+
+            source = target;
+            width = target_width;
+            height = target_height;
+        }
+
+        return source;
+    }
+
+    inline std::shared_ptr<OpenImageIO::ImageBuf> ImageKernels::run(const ImagePipeline &pipeline,
+                                                                   const OpenImageIO::ImageBuf &input,
+                                                                   OpenImageIO::TypeDesc format) {
+        const auto &spec = input.spec();
+
+        if (format.basetype == OpenImageIO::TypeDesc::UNKNOWN) {
+            format = spec.format;
+        }
+
+        auto texture = acquire(spec.width, spec.height);
+        texture->set(input);
+        set_swizzle(*texture, spec.nchannels);
+
+        auto result = run(pipeline, texture);
+        set_swizzle(*texture, 4);
+        release(texture);
+
+        result->bind();
+        const auto size = result->size();
+        auto output = std::make_shared<OpenImageIO::ImageBuf>(
+                "kernels", OpenImageIO::ImageSpec(size.width, size.height, spec.nchannels, format));
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+
+        if (spec.nchannels == 2) {
+            // Gray and alpha were swizzled into RGBA, keep R and A.
+            const size_t value = format.size();
+            const size_t pixels = size_t(size.width) * size.height;
+            std::vector<unsigned char> rgba(pixels * 4 * value);
+
+            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, Texture::pixel_type(format), rgba.data());
+
+            auto out = static_cast<unsigned char *>(output->localpixels());
+
+            for (size_t i = 0; i < pixels; ++i) {
+                std::copy(&rgba[i * 4 * value], &rgba[i * 4 * value] + value, out + i * 2 * value);
+                std::copy(&rgba[(i * 4 + 3) * value], &rgba[(i * 4 + 3) * value] + value, out + (i * 2 + 1) * value);
+            }
+        } else {
+            glGetTexImage(GL_TEXTURE_2D, 0, Texture::pixel_format(spec.nchannels), Texture::pixel_type(format),
+                          output->localpixels());
+        }
+
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        assertNoGLError("glGetTexImage");
+        GPGPU_TRACE_DOWNLOAD("ImageKernels::run", output->spec().image_bytes());
+
+        release(result);
+        return output;
+    }
+
+    inline void ImageKernels::set_swizzle(Texture2D &texture, int channels) {
+        // Gray (and alpha) images are processed as RGBA.
+        GLint swizzle[] = {GL_RED, GL_GREEN, GL_BLUE, GL_ALPHA};
+
+        if (channels == 1) {
+            swizzle[1] = swizzle[2] = GL_RED;
+            swizzle[3] = GL_ONE;
+        } else if (channels == 2) {
+            swizzle[1] = swizzle[2] = GL_RED;
+            swizzle[3] = GL_GREEN;
+        }
+
+        texture.bind();
+        glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swizzle);
+        assertNoGLError("glTexParameteriv");
+    }
+
+    inline std::shared_ptr<Texture2D> ImageKernels::acquire(unsigned int width, unsigned int height) {
+        auto &free = _textures[std::make_pair(width, height)];
+
+        if (!free.empty()) {
+            auto texture = free.back();
+            free.pop_back();
+            return texture;
+        }
+
+        auto texture = std::make_shared<Texture2D>(width, height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+        texture->label("image kernels");
+        return texture;
+    }
+
+    inline void ImageKernels::release(std::shared_ptr<Texture2D> texture) {
+        texture->bind();
+        const auto s = texture->size();
+        _textures[std::make_pair(static_cast<unsigned int>(s.width), static_cast<unsigned int>(s.height))]
+                .push_back(texture);
+    }
+
+    inline void ImageKernels::clear() {
+        _framebuffers.clear();
+        _textures.clear();
+    }
+}
+
+#endif /* GPGPU_OPENGL_IMAGEKERNELS_HPP */
@@ -0,0 +1,160 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_IMAGEWRITER_HPP
+#define GPGPU_IMAGEWRITER_HPP
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+
+#include <OpenImageIO/imagebuf.h>
+#include <OpenImageIO/imagebufalgo.h>
+
+#include "ThreadPool.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class ImageWriterError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Encodes and writes read back images on a pool of worker threads.
+     *
+     * The thread owning the OpenGL context only hands over the ImageBuf
+     * and continues rendering. write() blocks once `capacity` images are
+     * waiting, bounding the memory held by pending images.
+     */
+    class ImageWriter {
+    public:
+        /**
+         * Called on a worker thread once the image has been written,
+         * `error` is empty on success.
+         */
+        typedef std::function<void(const std::string &filename, const std::string &error)> Callback;
+
+        explicit ImageWriter(unsigned int threads = 0, size_t capacity = 0)
+                : _pool(threads, capacity) {
+
+        }
+
+        /**
+         * Blocks until all pending images are written, errors are only
+         * reported through callbacks and wait().
+         */
+        ~ImageWriter() {
+            _pool.wait();
+        }
+
+        /**
+         * @param flip Mirror vertically before encoding, OpenGL read backs are bottom-up.
+         */
+        void write(std::shared_ptr<OpenImageIO::ImageBuf> image, const std::string &filename,
+                   bool flip = false, Callback callback = nullptr);
+
+        /**
+         * Blocks until all pending images are written.
+         *
+         * @throws ImageWriterError if a write without callback failed.
+         */
+        void wait();
+
+        size_t threads() const {
+            return _pool.size();
+        }
+
+    protected:
+        ThreadPool _pool;
+        std::mutex _mutex;
+        std::string _error;
+
+        void encode(const OpenImageIO::ImageBuf &image, const std::string &filename,
+                    bool flip, const Callback &callback);
+    };
+
+
+    /*
+     * Definition
+     */
+    inline void ImageWriter::write(std::shared_ptr<OpenImageIO::ImageBuf> image, const std::string &filename,
+                                   bool flip, Callback callback) {
+        if (!image) {
+            throw ImageWriterError("Can't write an empty image to “" + filename + "”.");
+        }
+
+        _pool.submit([this, image, filename, flip, callback]() {
+            encode(*image, filename, flip, callback);
+        });
+    }
+
+    inline void ImageWriter::wait() {
+        _pool.wait();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_error.empty()) {
+            std::string error;
+            std::swap(error, _error);
+            throw ImageWriterError(error);
+        }
+    }
+
+    inline void ImageWriter::encode(const OpenImageIO::ImageBuf &image, const std::string &filename,
+                                    bool flip, const Callback &callback) {
+        std::string error;
+
+        try {
+            bool written;
+
+            if (flip) {
+                OpenImageIO::ImageBuf flipped;
+                written = OpenImageIO::ImageBufAlgo::flip(flipped, image) && flipped.write(filename);
+                error = written ? "" : flipped.geterror();
+            } else {
+                written = image.write(filename);
+                error = written ? "" : image.geterror();
+            }
+
+            if (!written && error.empty()) {
+                error = "unknown error";
+            }
+        } catch (const std::exception &e) {
+            error = e.what();
+        }
+
+        if (callback) {
+            callback(filename, error);
+        } else if (!error.empty()) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_error.empty()) {
+                _error = "Failed to write “" + filename + "”: " + error;
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_IMAGEWRITER_HPP */
@@ -0,0 +1,312 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_INDEXOPTIMIZER_HPP
+#define GPGPU_INDEXOPTIMIZER_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "Buffer.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class IndexOptimizerError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    static constexpr size_t DEFAULT_VERTEX_CACHE_SIZE = 16;
+
+    /**
+     * Average cache miss ratio: transformed vertices per triangle with a
+     * simulated FIFO post-transform cache, between 0.5 (ideal) and 3.
+     */
+    double acmr(const std::vector<unsigned int> &indices, size_t cache_size = DEFAULT_VERTEX_CACHE_SIZE);
+
+    /**
+     * Reorders the triangles of a triangle list for post-transform cache
+     * reuse (Tom Forsyth, “Linear-Speed Vertex Cache Optimisation”).
+     */
+    std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int> &indices, size_t vertices);
+
+    /**
+     * Renumbers vertices in order of first use so the vertex fetcher reads
+     * memory front to back, rewriting `indices` in place.
+     *
+     * @return Old to new vertex index, unreferenced vertices map to
+     *         std::numeric_limits<unsigned int>::max().
+     */
+    std::vector<unsigned int> optimize_vertex_fetch(std::vector<unsigned int> &indices, size_t vertices);
+
+    /**
+     * Applies a table of optimize_vertex_fetch() to vertex data with
+     * `vertex_size` bytes per vertex, dropping unreferenced vertices.
+     *
+     * @return Vertex count after remapping.
+     */
+    size_t remap_vertices(const std::vector<unsigned int> &remap, const void *vertices, size_t vertex_size,
+                          void *destination);
+
+    struct IndexOptimization {
+        double acmr_before;
+        double acmr_after;
+        size_t vertices;
+        Buffer::ValueType type;
+    };
+
+    /**
+     * Optimizes a triangle list for cache and fetch locality and uploads it
+     * with the narrowest index type. Vertex data has to be reordered with
+     * the returned `remap` table.
+     */
+    IndexOptimization optimize_indices(ElementArrayBuffer &faces, std::vector<unsigned int> indices,
+                                       size_t vertices, std::vector<unsigned int> &remap);
+
+
+    /*
+     * Definition
+     */
+    inline double acmr(const std::vector<unsigned int> &indices, size_t cache_size) {
+        if (cache_size == 0) {
+            throw IndexOptimizerError("Vertex cache size must be at least 1.");
+        }
+
+        if (indices.size() < 3) {
+            return 0;
+        }
+
+        std::vector<unsigned int> fifo(cache_size, std::numeric_limits<unsigned int>::max());
+        size_t head = 0;
+        size_t misses = 0;
+
+        for (auto index : indices) {
+            if (std::find(fifo.begin(), fifo.end(), index) == fifo.end()) {
+                fifo[head] = index;
+                head = (head + 1) % cache_size;
+                ++misses;
+            }
+        }
+
+        return static_cast<double>(misses) / (indices.size() / 3);
+    }
+
+    inline std::vector<unsigned int> optimize_vertex_cache(const std::vector<unsigned int> &indices,
+                                                           size_t vertices) {
+        static constexpr int cache_size = 32;
+
+        if (indices.size() % 3 != 0) {
+            throw IndexOptimizerError("Vertex cache optimization requires a triangle list.");
+        }
+
+        const size_t triangles = indices.size() / 3;
+
+        /*
+         * Triangles adjacent to each vertex, as offsets into one array.
+         */
+        std::vector<unsigned int> live(vertices, 0);
+        for (auto index : indices) {
+            if (index >= vertices) {
+                throw IndexOptimizerError("Index exceeds vertex count.");
+            }
+
+            ++live[index];
+        }
+
+        std::vector<size_t> offset(vertices + 1, 0);
+        for (size_t v = 0; v < vertices; ++v) {
+            offset[v + 1] = offset[v] + live[v];
+        }
+
+        std::vector<unsigned int> adjacency(indices.size());
+        {
+            std::vector<size_t> fill(offset.begin(), offset.end() - 1);
+            for (size_t i = 0; i < indices.size(); ++i) {
+                adjacency[fill[indices[i]]++] = i / 3;
+            }
+        }
+
+        auto score = [](int position, unsigned int remaining) {
+            if (remaining == 0) {
+                return -1.0f;
+            }
+
+            float s = 0;
+
+            if (position >= 0) {
+                // The last triangle's vertices score equally, regardless of their order.
+                s = position < 3 ? 0.75f : std::pow(1.0f - (position - 3) / float(cache_size - 3), 1.5f);
+            }
+
+            return s + 2.0f / std::sqrt(static_cast<float>(remaining));
+        };
+
+        std::vector<int> position(vertices, -1);
+        std::vector<float> vertex_score(vertices);
+        for (size_t v = 0; v < vertices; ++v) {
+            vertex_score[v] = score(-1, live[v]);
+        }
+
+        std::vector<float> triangle_score(triangles);
+        std::vector<bool> emitted(triangles, false);
+        for (size_t t = 0; t < triangles; ++t) {
+            triangle_score[t] = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] +
+                                vertex_score[indices[3 * t + 2]];
+        }
+
+        std::vector<unsigned int> result;
+        result.reserve(indices.size());
+
+        std::vector<unsigned int> cache;
+        cache.reserve(cache_size + 3);
+
+        size_t best = triangles == 0 ? 0 : std::max_element(triangle_score.begin(), triangle_score.end()) -
+                                           triangle_score.begin();
+        size_t scan = 0;
+
+        while (result.size() < indices.size()) {
+            if (best == triangles) {
+                // Nothing adjacent to the cache is left, continue with the next unemitted triangle.
+                while (emitted[scan]) {
+                    ++scan;
+                }
+
+                best = scan;
+            }
+
+            emitted[best] = true;
+
+            /*
+             * Emit, move the vertices to the front of the LRU cache.
+             */
+            for (int k = 0; k < 3; ++k) {
+                const unsigned int v = indices[3 * best + k];
+                result.push_back(v);
+
+                auto it = std::find(cache.begin(), cache.end(), v);
+                if (it != cache.end()) {
+                    cache.erase(it);
+                }
+
+                cache.insert(cache.begin() + std::min<size_t>(k, cache.size()), v);
+
+                // Remove the triangle from the vertex' live triangles.
+                auto first = adjacency.begin() + offset[v];
+                auto last = first + live[v];
+                std::iter_swap(std::find(first, last, static_cast<unsigned int>(best)), last - 1);
+                --live[v];
+            }
+
+            /*
+             * Rescore cached vertices, evicted ones fall back to no cache position.
+             */
+            for (size_t i = 0; i < cache.size(); ++i) {
+                const unsigned int v = cache[i];
+                position[v] = i < static_cast<size_t>(cache_size) ? static_cast<int>(i) : -1;
+                vertex_score[v] = score(position[v], live[v]);
+            }
+
+            best = triangles;
+            float best_score = -1;
+
+            for (auto v : cache) {
+                for (size_t a = offset[v]; a < offset[v] + live[v]; ++a) {
+                    const unsigned int t = adjacency[a];
+                    const float s = vertex_score[indices[3 * t]] + vertex_score[indices[3 * t + 1]] +
+                                    vertex_score[indices[3 * t + 2]];
+
+                    if (s > best_score) {
+                        best_score = s;
+                        best = t;
+                    }
+                }
+            }
+
+            if (cache.size() > static_cast<size_t>(cache_size)) {
+                cache.resize(cache_size);
+            }
+        }
+
+        return result;
+    }
+
+    inline std::vector<unsigned int> optimize_vertex_fetch(std::vector<unsigned int> &indices, size_t vertices) {
+        const unsigned int unused = std::numeric_limits<unsigned int>::max();
+        std::vector<unsigned int> remap(vertices, unused);
+        unsigned int next = 0;
+
+        for (auto &index : indices) {
+            if (index >= vertices) {
+                throw IndexOptimizerError("Index exceeds vertex count.");
+            }
+
+            if (remap[index] == unused) {
+                remap[index] = next++;
+            }
+
+            index = remap[index];
+        }
+
+        return remap;
+    }
+
+    inline size_t remap_vertices(const std::vector<unsigned int> &remap, const void *vertices, size_t vertex_size,
+                                 void *destination) {
+        auto in = static_cast<const unsigned char *>(vertices);
+        auto out = static_cast<unsigned char *>(destination);
+        size_t count = 0;
+
+        for (size_t v = 0; v < remap.size(); ++v) {
+            if (remap[v] != std::numeric_limits<unsigned int>::max()) {
+                std::memcpy(out + remap[v] * vertex_size, in + v * vertex_size, vertex_size);
+                ++count;
+            }
+        }
+
+        return count;
+    }
+
+    inline IndexOptimization optimize_indices(ElementArrayBuffer &faces, std::vector<unsigned int> indices,
+                                              size_t vertices, std::vector<unsigned int> &remap) {
+        IndexOptimization result;
+        result.acmr_before = acmr(indices);
+
+        indices = optimize_vertex_cache(indices, vertices);
+        remap = optimize_vertex_fetch(indices, vertices);
+
+        result.acmr_after = acmr(indices);
+        result.vertices = indices.empty() ? 0 : *std::max_element(indices.begin(), indices.end()) + 1;
+
+        faces.data_compact(indices.size() / 3, 3, indices.data());
+        result.type = faces.valueType();
+
+        return result;
+    }
+}
+
+#endif /* GPGPU_INDEXOPTIMIZER_HPP */
@@ -0,0 +1,412 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_INSTRUMENTATION_HPP
+#define GPGPU_INSTRUMENTATION_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Optional OpenGL call tracing, enabled by compiling with
+ * GPGPU_INSTRUMENTATION defined (cmake -DGPGPU_INSTRUMENTATION=ON).
+ *
+ * Calls through GLEW are intercepted by overriding GLEW_GET_FUN, which
+ * requires this header (or any gpgpu header) to be included before
+ * <GL/glew.h>. OpenGL 1.1 entry points are exported by libGL directly and
+ * wrapped by macros in OpenGLObject.hpp. Transfers are counted where the
+ * wrappers move pixels or buffer data.
+ *
+ * Without GPGPU_INSTRUMENTATION all of this compiles to nothing.
+ */
+#ifdef GPGPU_INSTRUMENTATION
+#define GLEW_GET_FUN(x) ::gpgpu::traced_call(x, #x)
+#define GPGPU_TRACED(f) ::gpgpu::traced_call(&::f, #f)
+#define GPGPU_TRACE_UPLOAD(site, bytes) \
+    ::gpgpu::Instrumentation::instance().record_transfer(site, ::gpgpu::Instrumentation::Upload, bytes)
+#define GPGPU_TRACE_DOWNLOAD(site, bytes) \
+    ::gpgpu::Instrumentation::instance().record_transfer(site, ::gpgpu::Instrumentation::Download, bytes)
+#define GPGPU_TRACE_SCOPE_NAME(line) gpgpu_trace_scope_##line
+#define GPGPU_TRACE_SCOPE_LINE(name, line) ::gpgpu::TraceScope GPGPU_TRACE_SCOPE_NAME(line)(name)
+#define GPGPU_TRACE_SCOPE(name) GPGPU_TRACE_SCOPE_LINE(name, __LINE__)
+#else
+#define GPGPU_TRACE_UPLOAD(site, bytes) ((void) 0)
+#define GPGPU_TRACE_DOWNLOAD(site, bytes) ((void) 0)
+#define GPGPU_TRACE_SCOPE(name) ((void) 0)
+#endif
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Process wide call, time and transfer statistics plus a bounded
+     * timeline of events, exported as summary table or Chrome trace
+     * (chrome://tracing, Perfetto).
+     */
+    class Instrumentation {
+    public:
+        typedef std::chrono::steady_clock Clock;
+
+        enum Direction {
+            Upload,
+            Download
+        };
+
+        struct CallStatistics {
+            size_t calls = 0;
+            double seconds = 0;
+            double max_seconds = 0;
+        };
+
+        struct TransferStatistics {
+            size_t calls = 0;
+            size_t bytes = 0;
+        };
+
+        static Instrumentation &instance() {
+            static Instrumentation instance;
+            return instance;
+        }
+
+        /**
+         * Records the CPU time of an OpenGL call, `name` has to be a string literal.
+         */
+        void record_call(const char *name, Clock::time_point start, Clock::time_point end);
+
+        /**
+         * Records a timeline span, e.g. a job or frame.
+         */
+        void record_scope(const char *name, Clock::time_point start, Clock::time_point end);
+
+        void record_transfer(const char *site, Direction direction, size_t bytes);
+
+        std::map<std::string, CallStatistics> calls() const;
+
+        std::map<std::pair<std::string, Direction>, TransferStatistics> transfers() const;
+
+        size_t bytes(Direction direction) const;
+
+        /**
+         * Caps the timeline, statistics are kept for events beyond it.
+         */
+        void set_max_events(size_t events);
+
+        void write_summary(std::ostream &s) const;
+
+        void write_chrome_trace(std::ostream &s) const;
+
+        void reset();
+
+    protected:
+        enum EventType {
+            CallEvent,
+            ScopeEvent,
+            TransferEvent
+        };
+
+        struct Event {
+            EventType type;
+            const std::string *name;
+            double start;
+            double duration;
+            size_t thread;
+            Direction direction;
+            size_t bytes;
+        };
+
+        mutable std::mutex _mutex;
+        Clock::time_point _origin = Clock::now();
+        size_t _max_events = 1000000;
+
+        std::map<std::string, CallStatistics> _calls;
+        std::unordered_map<const char *, std::pair<const std::string *, CallStatistics *>> _call_names;
+        std::map<std::pair<std::string, Direction>, TransferStatistics> _transfers;
+        std::map<std::string, char> _scope_names;
+        size_t _bytes[2] = {0, 0};
+        std::vector<Event> _events;
+
+        Instrumentation() = default;
+
+        /**
+         * "__glewBindBuffer" (GLEW's pointer) -> "glBindBuffer".
+         */
+        static std::string entry_point(const char *name);
+
+        double microseconds(Clock::time_point t) const {
+            return std::chrono::duration<double, std::micro>(t - _origin).count();
+        }
+
+        static size_t thread_id() {
+            return std::hash<std::thread::id>()(std::this_thread::get_id()) & 0xffff;
+        }
+
+        static void write_json_string(std::ostream &s, const std::string &value);
+    };
+
+    /**
+     * Measures its lifetime as timeline span.
+     */
+    class TraceScope {
+    public:
+        explicit TraceScope(const char *name)
+                : _instrumentation(Instrumentation::instance()), _name(name),
+                  _start(Instrumentation::Clock::now()) {
+
+        }
+
+        ~TraceScope() {
+            _instrumentation.record_scope(_name, _start, Instrumentation::Clock::now());
+        }
+
+        TraceScope(const TraceScope &) = delete;
+
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        Instrumentation &_instrumentation;
+        const char *_name;
+        Instrumentation::Clock::time_point _start;
+    };
+
+    /**
+     * Function pointer that records every call made through it.
+     */
+    template<typename R, typename... Args>
+    struct TracedCall {
+        R (*function)(Args...);
+        const char *name;
+
+        R operator()(Args... args) const {
+            // Instance first, its timeline starts on construction.
+            struct Timer {
+                Instrumentation &instrumentation;
+                const char *name;
+                Instrumentation::Clock::time_point start;
+
+                ~Timer() {
+                    instrumentation.record_call(name, start, Instrumentation::Clock::now());
+                }
+            } timer = {Instrumentation::instance(), name, Instrumentation::Clock::now()};
+
+            return function(args...);
+        }
+    };
+
+    template<typename R, typename... Args>
+    TracedCall<R, Args...> traced_call(R (*function)(Args...), const char *name) {
+        return TracedCall<R, Args...>{function, name};
+    }
+
+
+    /*
+     * Definition
+     */
+    inline std::string Instrumentation::entry_point(const char *name) {
+        if (std::strncmp(name, "__glew", 6) == 0) {
+            return std::string("gl") + (name + 6);
+        }
+
+        return name;
+    }
+
+    inline void Instrumentation::record_call(const char *name, Clock::time_point start, Clock::time_point end) {
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Names are literals, cache their statistics by address.
+        auto &entry = _call_names[name];
+
+        if (entry.second == nullptr) {
+            auto it = _calls.insert(std::make_pair(entry_point(name), CallStatistics())).first;
+            entry = std::make_pair(&it->first, &it->second);
+        }
+
+        auto &statistics = *entry.second;
+        ++statistics.calls;
+        statistics.seconds += seconds;
+        statistics.max_seconds = std::max(statistics.max_seconds, seconds);
+
+        if (_events.size() < _max_events) {
+            _events.push_back({CallEvent, entry.first, microseconds(start), seconds * 1e6, thread_id(), Upload, 0});
+        }
+    }
+
+    inline void Instrumentation::record_scope(const char *name, Clock::time_point start, Clock::time_point end) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        if (_events.size() < _max_events) {
+            auto it = _scope_names.insert(std::make_pair(std::string(name), 0)).first;
+            _events.push_back({ScopeEvent, &it->first, microseconds(start),
+                               std::chrono::duration<double, std::micro>(end - start).count(), thread_id(), Upload,
+                               0});
+        }
+    }
+
+    inline void Instrumentation::record_transfer(const char *site, Direction direction, size_t bytes) {
+        const auto now = Clock::now();
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        auto it = _transfers.insert(std::make_pair(std::make_pair(std::string(site), direction),
+                                                   TransferStatistics())).first;
+        ++it->second.calls;
+        it->second.bytes += bytes;
+        _bytes[direction] += bytes;
+
+        if (_events.size() < _max_events) {
+            _events.push_back({TransferEvent, &it->first.first, microseconds(now), 0, thread_id(), direction,
+                               _bytes[direction]});
+        }
+    }
+
+    inline std::map<std::string, Instrumentation::CallStatistics> Instrumentation::calls() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _calls;
+    }
+
+    inline std::map<std::pair<std::string, Instrumentation::Direction>, Instrumentation::TransferStatistics>
+    Instrumentation::transfers() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _transfers;
+    }
+
+    inline size_t Instrumentation::bytes(Direction direction) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _bytes[direction];
+    }
+
+    inline void Instrumentation::set_max_events(size_t events) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _max_events = events;
+    }
+
+    inline void Instrumentation::reset() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _calls.clear();
+        _call_names.clear();
+        _transfers.clear();
+        _scope_names.clear();
+        _bytes[Upload] = _bytes[Download] = 0;
+        _events.clear();
+        _origin = Clock::now();
+    }
+
+    inline void Instrumentation::write_summary(std::ostream &s) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        // Most expensive entry points first.
+        std::vector<std::pair<std::string, CallStatistics>> calls(_calls.begin(), _calls.end());
+        std::sort(calls.begin(), calls.end(), [](const std::pair<std::string, CallStatistics> &a,
+                                                 const std::pair<std::string, CallStatistics> &b) {
+            return a.second.seconds > b.second.seconds;
+        });
+
+        const auto flags = s.flags();
+        const auto precision = s.precision();
+        s << std::fixed << std::setprecision(3);
+
+        s << std::left << std::setw(36) << "entry point" << std::right << std::setw(10) << "calls"
+          << std::setw(14) << "total ms" << std::setw(12) << "avg us" << std::setw(12) << "max us" << "\n";
+
+        for (const auto &c : calls) {
+            s << std::left << std::setw(36) << c.first << std::right << std::setw(10) << c.second.calls
+              << std::setw(14) << c.second.seconds * 1e3
+              << std::setw(12) << c.second.seconds * 1e6 / c.second.calls
+              << std::setw(12) << c.second.max_seconds * 1e6 << "\n";
+        }
+
+        s << "\n" << std::left << std::setw(36) << "transfer" << std::right << std::setw(10) << "calls"
+          << std::setw(14) << "bytes" << "\n";
+
+        for (const auto &t : _transfers) {
+            s << std::left << std::setw(36) << (t.first.first + (t.first.second == Upload ? " (up)" : " (down)"))
+              << std::right << std::setw(10) << t.second.calls << std::setw(14) << t.second.bytes << "\n";
+        }
+
+        s << "uploaded " << _bytes[Upload] << " bytes, downloaded " << _bytes[Download] << " bytes\n";
+
+        s.flags(flags);
+        s.precision(precision);
+    }
+
+    inline void Instrumentation::write_json_string(std::ostream &s, const std::string &value) {
+        s << '"';
+
+        for (auto c : value) {
+            if (c == '"' || c == '\\') {
+                s << '\\';
+            }
+
+            s << c;
+        }
+
+        s << '"';
+    }
+
+    inline void Instrumentation::write_chrome_trace(std::ostream &s) const {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        const auto flags = s.flags();
+        const auto precision = s.precision();
+        s << std::fixed << std::setprecision(3);
+
+        s << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+        bool first = true;
+
+        for (const auto &e : _events) {
+            s << (first ? "\n" : ",\n");
+            first = false;
+
+            if (e.type == TransferEvent) {
+                // Counter track with the running totals per direction.
+                s << "{\"name\":" << (e.direction == Upload ? "\"bytes uploaded\"" : "\"bytes downloaded\"")
+                  << ",\"ph\":\"C\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.start
+                  << ",\"args\":{\"bytes\":" << e.bytes << "}}";
+                continue;
+            }
+
+            s << "{\"name\":";
+            write_json_string(s, *e.name);
+            s << ",\"cat\":" << (e.type == CallEvent ? "\"gl\"" : "\"scope\"")
+              << ",\"ph\":\"X\",\"pid\":1,\"tid\":" << e.thread << ",\"ts\":" << e.start
+              << ",\"dur\":" << e.duration << "}";
+        }
+
+        s << "\n]}\n";
+
+        s.flags(flags);
+        s.precision(precision);
+    }
+}
+
+#endif /* GPGPU_INSTRUMENTATION_HPP */
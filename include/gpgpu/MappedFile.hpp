@@ -0,0 +1,158 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_MAPPEDFILE_HPP
+#define GPGPU_MAPPEDFILE_HPP
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class MappedFileError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Read-only memory mapping of a whole file (POSIX).
+     */
+    class MappedFile {
+    public:
+        explicit MappedFile(const std::string &filename);
+
+        ~MappedFile();
+
+        MappedFile(const MappedFile &) = delete;
+
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        const unsigned char *data() const {
+            return _data;
+        }
+
+        size_t size() const {
+            return _size;
+        }
+
+        const std::string &filename() const {
+            return _filename;
+        }
+
+        /**
+         * Hints that [offset, offset + length) is read front to back.
+         */
+        void sequential(size_t offset, size_t length) const;
+
+        /**
+         * Drops the pages of [offset, offset + length) from the resident set
+         * once they have been consumed. They are read again from the file if
+         * accessed later.
+         */
+        void release(size_t offset, size_t length) const;
+
+    protected:
+        std::string _filename;
+        const unsigned char *_data = nullptr;
+        size_t _size = 0;
+
+        void advise(size_t offset, size_t length, int advice) const;
+    };
+
+
+    /*
+     * Definition
+     */
+    inline MappedFile::MappedFile(const std::string &filename) : _filename(filename) {
+        int fd = open(filename.c_str(), O_RDONLY);
+
+        if (fd < 0) {
+            throw MappedFileError("Failed to open “" + filename + "”: " + std::strerror(errno));
+        }
+
+        struct stat info;
+        if (fstat(fd, &info) != 0) {
+            int error = errno;
+            close(fd);
+            throw MappedFileError("Failed to stat “" + filename + "”: " + std::strerror(error));
+        }
+
+        _size = static_cast<size_t>(info.st_size);
+
+        if (_size > 0) {
+            void *p = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+            if (p == MAP_FAILED) {
+                int error = errno;
+                close(fd);
+                throw MappedFileError("Failed to map “" + filename + "”: " + std::strerror(error));
+            }
+
+            _data = static_cast<const unsigned char *>(p);
+        }
+
+        // The mapping stays valid after closing the descriptor.
+        close(fd);
+    }
+
+    inline MappedFile::~MappedFile() {
+        if (_data != nullptr) {
+            munmap(const_cast<unsigned char *>(_data), _size);
+        }
+    }
+
+    inline void MappedFile::sequential(size_t offset, size_t length) const {
+        advise(offset, length, MADV_SEQUENTIAL);
+    }
+
+    inline void MappedFile::release(size_t offset, size_t length) const {
+        advise(offset, length, MADV_DONTNEED);
+    }
+
+    inline void MappedFile::advise(size_t offset, size_t length, int advice) const {
+        if (_data == nullptr || offset >= _size) {
+            return;
+        }
+
+        /*
+         * Advice works on whole pages, round the start down to a page boundary.
+         * madvise() instead of posix_madvise() since glibc ignores POSIX_MADV_DONTNEED.
+         */
+        const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        const size_t begin = offset - offset % page;
+        const size_t end = std::min(offset + length, _size);
+
+        madvise(const_cast<unsigned char *>(_data) + begin, end - begin, advice);
+    }
+}
+
+#endif /* GPGPU_MAPPEDFILE_HPP */
@@ -0,0 +1,299 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_MEMORYTRACKER_HPP
+#define GPGPU_MEMORYTRACKER_HPP
+
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class MemoryBudgetError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Accounts the GPU memory allocated by buffers, textures and
+     * renderbuffers of one context, by resource type and by label.
+     *
+     * Every Context owns a tracker and makes it current for its thread in
+     * make_current(), resources created afterwards report to it.
+     */
+    class MemoryTracker {
+    public:
+        enum ResourceType {
+            BufferMemory,
+            TextureMemory,
+            RenderbufferMemory,
+            ResourceTypes
+        };
+
+        struct Usage {
+            size_t live = 0;
+            size_t peak = 0;
+            size_t resources = 0;
+        };
+
+        struct Statistics {
+            Usage total;
+            Usage types[ResourceTypes];
+            std::map<std::string, Usage> labels;
+            size_t budget = 0;
+        };
+
+        /**
+         * Called with the number of bytes that need to be freed to stay
+         * within budget. It may release resources of the same context.
+         */
+        typedef std::function<void(size_t needed)> EvictionCallback;
+
+        /**
+         * Allocations that would exceed `bytes` first trigger the eviction
+         * callbacks and then fail with MemoryBudgetError, 0 disables the budget.
+         */
+        void set_budget(size_t bytes);
+
+        void on_over_budget(EvictionCallback callback);
+
+        Statistics statistics() const;
+
+        static const char *name(ResourceType type);
+
+        static std::shared_ptr<MemoryTracker> &current() {
+            static thread_local std::shared_ptr<MemoryTracker> tracker;
+            return tracker;
+        }
+
+    protected:
+        friend class MemoryAllocation;
+
+        mutable std::mutex _mutex;
+        Statistics _statistics;
+        std::vector<EvictionCallback> _eviction;
+
+        void reserve(size_t bytes);
+
+        void add(ResourceType type, const std::string &label, size_t bytes, int resources);
+
+        void remove(ResourceType type, const std::string &label, size_t bytes, int resources);
+
+        static void add(Usage &usage, size_t bytes, int resources);
+    };
+
+    /**
+     * The bytes one resource holds, registered with the tracker current
+     * at construction.
+     */
+    class MemoryAllocation {
+    public:
+        explicit MemoryAllocation(MemoryTracker::ResourceType type)
+                : _tracker(MemoryTracker::current()), _type(type) {
+
+        }
+
+        ~MemoryAllocation() {
+            resize(0);
+        }
+
+        MemoryAllocation(const MemoryAllocation &) = delete;
+
+        MemoryAllocation &operator=(const MemoryAllocation &) = delete;
+
+        /**
+         * Call before allocating on the GPU.
+         *
+         * @throws MemoryBudgetError if growing exceeds the budget even after eviction.
+         */
+        void resize(size_t bytes);
+
+        void label(const std::string &label);
+
+        const std::string &label() const {
+            return _label;
+        }
+
+        size_t bytes() const {
+            return _bytes;
+        }
+
+    protected:
+        std::shared_ptr<MemoryTracker> _tracker;
+        MemoryTracker::ResourceType _type;
+        std::string _label;
+        size_t _bytes = 0;
+    };
+
+    std::ostream &operator<<(std::ostream &s, const MemoryTracker::Statistics &statistics);
+
+
+    /*
+     * Definition
+     */
+    inline void MemoryTracker::set_budget(size_t bytes) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _statistics.budget = bytes;
+    }
+
+    inline void MemoryTracker::on_over_budget(EvictionCallback callback) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _eviction.push_back(std::move(callback));
+    }
+
+    inline MemoryTracker::Statistics MemoryTracker::statistics() const {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _statistics;
+    }
+
+    inline const char *MemoryTracker::name(ResourceType type) {
+        switch (type) {
+            case BufferMemory:
+                return "buffer";
+            case TextureMemory:
+                return "texture";
+            case RenderbufferMemory:
+                return "renderbuffer";
+            default:
+                return "unknown";
+        }
+    }
+
+    inline void MemoryTracker::reserve(size_t bytes) {
+        std::vector<EvictionCallback> eviction;
+        size_t needed;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto budget = _statistics.budget;
+            const auto live = _statistics.total.live;
+
+            if (budget == 0 || live + bytes <= budget) {
+                return;
+            }
+
+            needed = live + bytes - budget;
+            eviction = _eviction;
+        }
+
+        // Without the lock, callbacks release resources which report back here.
+        for (auto &evict : eviction) {
+            evict(needed);
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto budget = _statistics.budget;
+        const auto live = _statistics.total.live;
+
+        if (budget != 0 && live + bytes > budget) {
+            std::stringstream s;
+            s << "Allocating " << bytes << " bytes exceeds the GPU memory budget (" << live << " of " << budget <<
+                    " bytes in use).";
+            throw MemoryBudgetError(s.str());
+        }
+    }
+
+    inline void MemoryTracker::add(Usage &usage, size_t bytes, int resources) {
+        usage.live += bytes;
+        usage.resources += resources;
+        usage.peak = std::max(usage.peak, usage.live);
+    }
+
+    inline void MemoryTracker::add(ResourceType type, const std::string &label, size_t bytes, int resources) {
+        std::lock_guard<std::mutex> lock(_mutex);
+        add(_statistics.total, bytes, resources);
+        add(_statistics.types[type], bytes, resources);
+
+        if (!label.empty()) {
+            add(_statistics.labels[label], bytes, resources);
+        }
+    }
+
+    inline void MemoryTracker::remove(ResourceType type, const std::string &label, size_t bytes, int resources) {
+        std::lock_guard<std::mutex> lock(_mutex);
+
+        for (Usage *usage : {&_statistics.total, &_statistics.types[type],
+                             label.empty() ? nullptr : &_statistics.labels[label]}) {
+            if (usage != nullptr) {
+                usage->live -= bytes;
+                usage->resources -= resources;
+            }
+        }
+    }
+
+    inline void MemoryAllocation::resize(size_t bytes) {
+        if (!_tracker) {
+            _bytes = bytes;
+            return;
+        }
+
+        // Only allocations holding memory count as resources.
+        if (bytes > _bytes) {
+            _tracker->reserve(bytes - _bytes);
+            _tracker->add(_type, _label, bytes - _bytes, _bytes == 0 ? 1 : 0);
+        } else if (bytes < _bytes) {
+            _tracker->remove(_type, _label, _bytes - bytes, bytes == 0 ? 1 : 0);
+        }
+
+        _bytes = bytes;
+    }
+
+    inline void MemoryAllocation::label(const std::string &label) {
+        if (_tracker && _bytes > 0) {
+            _tracker->remove(_type, _label, _bytes, 1);
+            _tracker->add(_type, label, _bytes, 1);
+        }
+
+        _label = label;
+    }
+
+    inline std::ostream &operator<<(std::ostream &s, const MemoryTracker::Statistics &statistics) {
+        auto line = [&s](const std::string &name, const MemoryTracker::Usage &usage) {
+            s << name << ": live=" << usage.live << " peak=" << usage.peak << " resources=" << usage.resources << "\n";
+        };
+
+        line("total", statistics.total);
+
+        for (int t = 0; t < MemoryTracker::ResourceTypes; ++t) {
+            line(MemoryTracker::name(static_cast<MemoryTracker::ResourceType>(t)), statistics.types[t]);
+        }
+
+        for (const auto &label : statistics.labels) {
+            line("label “" + label.first + "”", label.second);
+        }
+
+        s << "budget: " << statistics.budget << "\n";
+        return s;
+    }
+}
+
+#endif /* GPGPU_MEMORYTRACKER_HPP */
@@ -0,0 +1,258 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_MESHFILE_HPP
+#define GPGPU_MESHFILE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "Buffer.hpp"
+#include "MappedFile.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+    class MeshFileError : public std::runtime_error {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    /**
+     * Binary mesh container, native byte order:
+     *
+     *   header | padding | vertices | padding | faces
+     *
+     * Both sections start at a multiple of MESH_FILE_ALIGNMENT and hold
+     * tightly packed values of the recorded Buffer::ValueType, i.e. exactly
+     * the bytes ArrayBuffer and ElementArrayBuffer store.
+     */
+    struct MeshFileHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t vertex_elements;
+        uint32_t vertex_dimension;
+        uint32_t vertex_type;
+        uint64_t face_elements;
+        uint32_t face_dimension;
+        uint32_t face_type;
+        uint64_t vertex_offset;
+        uint64_t face_offset;
+    };
+
+    static_assert(sizeof(MeshFileHeader) == 56, "MeshFileHeader must not contain padding.");
+
+    static constexpr char MESH_FILE_MAGIC[4] = {'G', 'P', 'M', 'F'};
+    static constexpr uint32_t MESH_FILE_VERSION = 1;
+    static constexpr size_t MESH_FILE_ALIGNMENT = 64;
+    static constexpr size_t MESH_FILE_DEFAULT_CHUNK = 16 << 20;
+
+    template<typename V, typename F>
+    void write_mesh_file(const std::string &filename,
+                         size_t vertex_elements, unsigned char vertex_dimension, const V *vertices,
+                         size_t face_elements, unsigned char face_dimension, const F *faces);
+
+    /**
+     * Memory mapped mesh file, uploaded without an intermediate heap copy.
+     */
+    class MeshFile {
+    public:
+        explicit MeshFile(const std::string &filename);
+
+        const MeshFileHeader &header() const {
+            return _header;
+        }
+
+        const void *vertices() const {
+            return _file.data() + _header.vertex_offset;
+        }
+
+        const void *faces() const {
+            return _file.data() + _header.face_offset;
+        }
+
+        size_t vertex_bytes() const {
+            return section_bytes(_header.vertex_elements, _header.vertex_dimension, _header.vertex_type);
+        }
+
+        size_t face_bytes() const {
+            return section_bytes(_header.face_elements, _header.face_dimension, _header.face_type);
+        }
+
+        /**
+         * Streams both sections into the buffers `chunk_size` bytes at a time.
+         * Uploaded pages are dropped from the mapping right away, so the
+         * resident size stays around one chunk no matter the mesh size.
+         */
+        void upload(ArrayBuffer &vertices, ElementArrayBuffer &faces,
+                    size_t chunk_size = MESH_FILE_DEFAULT_CHUNK) const;
+
+    protected:
+        MappedFile _file;
+        MeshFileHeader _header;
+
+        static size_t section_bytes(uint64_t elements, uint32_t dimension, uint32_t type) {
+            return elements * dimension * Buffer::value_size(static_cast<Buffer::ValueType>(type));
+        }
+
+        void stream(Buffer &buffer, uint64_t offset, uint64_t elements, uint32_t dimension, uint32_t type,
+                    size_t chunk_size) const;
+
+        /**
+         * Checks a section's value type and dimension and that it lies
+         * within the file, without overflowing on corrupt headers.
+         */
+        void assert_section(const char *name, uint64_t offset, uint64_t elements, uint32_t dimension,
+                            uint32_t type) const;
+    };
+
+
+    /*
+     * Definition
+     */
+    template<typename V, typename F>
+    void write_mesh_file(const std::string &filename,
+                         size_t vertex_elements, unsigned char vertex_dimension, const V *vertices,
+                         size_t face_elements, unsigned char face_dimension, const F *faces) {
+        auto aligned = [](uint64_t offset) {
+            return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+        };
+
+        MeshFileHeader header;
+        std::memcpy(header.magic, MESH_FILE_MAGIC, sizeof(header.magic));
+        header.version = MESH_FILE_VERSION;
+        header.vertex_elements = vertex_elements;
+        header.vertex_dimension = vertex_dimension;
+        header.vertex_type = BufferValueType<V>::value;
+        header.face_elements = face_elements;
+        header.face_dimension = face_dimension;
+        header.face_type = BufferValueType<F>::value;
+
+        const uint64_t vertex_bytes = uint64_t(vertex_elements) * vertex_dimension * sizeof(V);
+        const uint64_t face_bytes = uint64_t(face_elements) * face_dimension * sizeof(F);
+        header.vertex_offset = aligned(sizeof(header));
+        header.face_offset = aligned(header.vertex_offset + vertex_bytes);
+
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        const char padding[MESH_FILE_ALIGNMENT] = {};
+
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        out.write(padding, header.vertex_offset - sizeof(header));
+        out.write(reinterpret_cast<const char *>(vertices), vertex_bytes);
+        out.write(padding, header.face_offset - header.vertex_offset - vertex_bytes);
+        out.write(reinterpret_cast<const char *>(faces), face_bytes);
+
+        if (!out) {
+            throw MeshFileError("Failed to write mesh file “" + filename + "”.");
+        }
+    }
+
+    inline MeshFile::MeshFile(const std::string &filename) : _file(filename) {
+        if (_file.size() < sizeof(_header)) {
+            throw MeshFileError("“" + filename + "” is too small to be a mesh file.");
+        }
+
+        std::memcpy(&_header, _file.data(), sizeof(_header));
+
+        if (std::memcmp(_header.magic, MESH_FILE_MAGIC, sizeof(_header.magic)) != 0) {
+            throw MeshFileError("“" + filename + "” is not a mesh file.");
+        }
+
+        if (_header.version != MESH_FILE_VERSION) {
+            std::stringstream s;
+            s << "Mesh file “" << filename << "” has unsupported version " << _header.version << ".";
+            throw MeshFileError(s.str());
+        }
+
+        assert_section("vertex", _header.vertex_offset, _header.vertex_elements, _header.vertex_dimension,
+                       _header.vertex_type);
+        assert_section("face", _header.face_offset, _header.face_elements, _header.face_dimension,
+                       _header.face_type);
+    }
+
+    inline void MeshFile::assert_section(const char *name, uint64_t offset, uint64_t elements,
+                                         uint32_t dimension, uint32_t type) const {
+        switch (type) {
+            case Buffer::Byte:
+            case Buffer::UnsignedByte:
+            case Buffer::Short:
+            case Buffer::UnsignedShort:
+            case Buffer::Integer:
+            case Buffer::UnsignedInteger:
+            case Buffer::HalfFloat:
+            case Buffer::Float:
+            case Buffer::Double:
+            case Buffer::Fixed:
+                break;
+            default: {
+                std::stringstream s;
+                s << "Mesh file “" << _file.filename() << "” has an unknown " << name << " type 0x" << std::hex <<
+                        type << ".";
+                throw MeshFileError(s.str());
+            }
+        }
+
+        if (dimension < 1 || dimension > 4) {
+            std::stringstream s;
+            s << "Mesh file “" << _file.filename() << "” has " << dimension << " " << name <<
+                    " components, needs 1 to 4.";
+            throw MeshFileError(s.str());
+        }
+
+        const uint64_t size = _file.size();
+        const uint64_t element_bytes = dimension * Buffer::value_size(static_cast<Buffer::ValueType>(type));
+
+        if (offset > size || elements > (size - offset) / element_bytes) {
+            throw MeshFileError("Mesh file “" + _file.filename() + "” is truncated.");
+        }
+    }
+
+    inline void MeshFile::upload(ArrayBuffer &vertices, ElementArrayBuffer &faces, size_t chunk_size) const {
+        stream(vertices, _header.vertex_offset, _header.vertex_elements, _header.vertex_dimension,
+               _header.vertex_type, chunk_size);
+        stream(faces, _header.face_offset, _header.face_elements, _header.face_dimension,
+               _header.face_type, chunk_size);
+    }
+
+    inline void MeshFile::stream(Buffer &buffer, uint64_t offset, uint64_t elements, uint32_t dimension,
+                                 uint32_t type, size_t chunk_size) const {
+        buffer.allocate(elements, dimension, static_cast<Buffer::ValueType>(type));
+
+        const size_t size = buffer.bytes();
+        chunk_size = std::max<size_t>(chunk_size, 1);
+        _file.sequential(offset, size);
+
+        for (size_t done = 0; done < size; done += chunk_size) {
+            const size_t n = std::min(chunk_size, size - done);
+            buffer.sub_data(done, n, _file.data() + offset + done);
+            _file.release(offset + done, n);
+        }
+    }
+}
+
+#endif /* GPGPU_MESHFILE_HPP */
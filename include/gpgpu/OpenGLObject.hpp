@@ -26,8 +26,43 @@
 #include <sstream>
 #include <stdexcept>
 
+// Has to precede GLEW to intercept its entry points.
+#include "Instrumentation.hpp"
+
 #include <GL/glew.h>
 
+#ifdef GPGPU_INSTRUMENTATION
+/*
+ * OpenGL 1.1 entry points used by the wrappers, exported by libGL directly
+ * instead of through GLEW's function pointers.
+ */
+#define glBindTexture GPGPU_TRACED(glBindTexture)
+#define glClear GPGPU_TRACED(glClear)
+#define glColorMask GPGPU_TRACED(glColorMask)
+#define glDeleteTextures GPGPU_TRACED(glDeleteTextures)
+#define glDepthMask GPGPU_TRACED(glDepthMask)
+#define glDisable GPGPU_TRACED(glDisable)
+#define glDrawArrays GPGPU_TRACED(glDrawArrays)
+#define glDrawBuffer GPGPU_TRACED(glDrawBuffer)
+#define glDrawElements GPGPU_TRACED(glDrawElements)
+#define glEnable GPGPU_TRACED(glEnable)
+#define glGenTextures GPGPU_TRACED(glGenTextures)
+#define glGetBooleanv GPGPU_TRACED(glGetBooleanv)
+#define glGetError GPGPU_TRACED(glGetError)
+#define glGetIntegerv GPGPU_TRACED(glGetIntegerv)
+#define glGetString GPGPU_TRACED(glGetString)
+#define glGetTexImage GPGPU_TRACED(glGetTexImage)
+#define glGetTexLevelParameteriv GPGPU_TRACED(glGetTexLevelParameteriv)
+#define glPixelStorei GPGPU_TRACED(glPixelStorei)
+#define glReadBuffer GPGPU_TRACED(glReadBuffer)
+#define glReadPixels GPGPU_TRACED(glReadPixels)
+#define glTexImage2D GPGPU_TRACED(glTexImage2D)
+#define glTexParameteri GPGPU_TRACED(glTexParameteri)
+#define glTexParameteriv GPGPU_TRACED(glTexParameteriv)
+#define glTexSubImage2D GPGPU_TRACED(glTexSubImage2D)
+#define glViewport GPGPU_TRACED(glViewport)
+#endif
+
 namespace gpgpu {
 
     class OpenGLError : public std::runtime_error {
@@ -23,6 +23,7 @@
 #ifndef GPGPU_OPENGL_PROGRAM_HPP
 #define GPGPU_OPENGL_PROGRAM_HPP
 
+#include <algorithm>
 #include <list>
 #include <vector>
 #include <memory>
@@ -36,6 +37,7 @@
 #include "OpenGLObject.hpp"
 #include "Buffer.hpp"
 #include "Texture.hpp"
+#include "VertexFormat.hpp"
 
 namespace gpgpu {
 
@@ -94,6 +96,20 @@ namespace gpgpu {
 
         void append(std::initializer_list<std::shared_ptr<Shader>> shader);
 
+        /**
+         * Captures the named vertex shader outputs with transform feedback,
+         * has to be called before link().
+         *
+         * @param mode GL_SEPARATE_ATTRIBS (one buffer per varying) or GL_INTERLEAVED_ATTRIBS.
+         */
+        void feedback_varyings(std::initializer_list<std::string> varyings, GLenum mode = GL_SEPARATE_ATTRIBS);
+
+        /**
+         * Allows binding the program's stages into a ProgramPipeline,
+         * has to be called before link().
+         */
+        void set_separable(bool separable = true);
+
         void link();
 
         void use();
@@ -102,6 +118,14 @@ namespace gpgpu {
 
         void attribute(const std::string &name, std::shared_ptr<ArrayBuffer> buffer);
 
+        /**
+         * Binds all attributes of an interleaved buffer, names are given in
+         * the order of the format's attributes. An empty name skips an
+         * attribute the shader doesn't use.
+         */
+        template<typename Format>
+        void attributes(std::shared_ptr<VertexBuffer<Format>> buffer, std::initializer_list<std::string> names);
+
         void uniform(size_t location, std::initializer_list<int> value);
 
         void uniform(size_t location, std::initializer_list<unsigned int> value);
@@ -120,73 +144,22 @@ namespace gpgpu {
         void setUniformLocation(size_t location,
                                 const Eigen::Matrix<float, _Rows, _Cols, _Options, _MaxRows, _MaxCols> &value,
                                 size_t arrayLength = 1) {
-            const auto cols = value.cols();
-            const auto rows = value.rows() / arrayLength;
-
             if (_Options == Eigen::RowMajor) {
                 Eigen::Matrix<float, _Rows, _Cols, _Options, _MaxRows, _MaxCols> m = value.transpose();
                 setUniformLocation(location, m, arrayLength);
                 return;
             }
 
-            if (cols == 1) {
-                if (rows == 1) {
-                    glUniform1fv(location, arrayLength, value.data());
-                } else if (rows == 2) {
-                    glUniform2fv(location, arrayLength, value.data());
-                } else if (rows == 3) {
-                    glUniform3fv(location, arrayLength, value.data());
-                } else if (rows == 4) {
-                    glUniform4fv(location, arrayLength, value.data());
-                } else {
-                    throw ProgramError::uniform(rows, cols, arrayLength);
-                }
-            } else if (cols == 2) {
-                if (rows == 2) {
-                    glUniformMatrix2fv(location, arrayLength,
-                                       GL_FALSE, value.data());
-                } else if (rows == 3) {
-                    glUniformMatrix2x3fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else if (rows == 4) {
-                    glUniformMatrix2x4fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else {
-                    throw ProgramError::uniform(rows, cols, arrayLength);
-                }
-            } else if (cols == 3) {
-                if (rows == 2) {
-                    glUniformMatrix3x2fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else if (rows == 3) {
-                    glUniformMatrix3fv(location, arrayLength,
-                                       GL_FALSE, value.data());
-                } else if (rows == 4) {
-                    glUniformMatrix3x4fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else {
-                    throw ProgramError::uniform(rows, cols, arrayLength);
-                }
-            } else if (cols == 4) {
-                if (rows == 2) {
-                    glUniformMatrix4x2fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else if (rows == 3) {
-                    glUniformMatrix4x3fv(location, arrayLength,
-                                         GL_FALSE, value.data());
-                } else if (rows == 4) {
-                    glUniformMatrix4fv(location, arrayLength,
-                                       GL_FALSE, value.data());
-                } else {
-                    throw ProgramError::uniform(rows, cols, arrayLength);
-                }
-            } else {
-                throw ProgramError::uniform(rows, cols, arrayLength);
-            }
-
-            assertNoGLError("setUniform(Eigen::Matrix)");
+            setUniformLocation(location, value.rows() / arrayLength, value.cols(), value.data(), arrayLength);
         }
 
+        /**
+         * Sets a float vector or matrix uniform from column-major values,
+         * `rows` counts the rows of a single array element.
+         */
+        void setUniformLocation(size_t location, size_t rows, size_t cols, const float *value,
+                                size_t arrayLength = 1);
+
         template<int _Rows, int _Cols, int _Options, int _MaxRows, int _MaxCols>
         void uniform(const std::string &location,
                      const Eigen::Matrix<float, _Rows, _Cols, _Options, _MaxRows, _MaxCols> &value,
@@ -202,12 +175,40 @@ namespace gpgpu {
 
         void render(std::shared_ptr<ArrayBuffer> vertices, const std::string &location, GLenum mode);
 
+        template<typename Format>
+        void render(std::shared_ptr<VertexBuffer<Format>> vertices, std::initializer_list<std::string> names,
+                    GLenum mode);
+
+        /**
+         * Runs the vertex shader once per element of `vertices` with
+         * rasterization disabled and writes the feedback varyings into
+         * `outputs`, in the order given to feedback_varyings(). Outputs need
+         * to be allocated (Buffer::allocate) for at least as many elements,
+         * with the dimension of the varyings they capture, and can be used
+         * as input of the next transform right away.
+         */
+        void transform(std::shared_ptr<ArrayBuffer> vertices, const std::string &location,
+                       std::initializer_list<std::shared_ptr<ArrayBuffer>> outputs);
+
     protected:
         GLuint _programID;
         std::vector<std::shared_ptr<Shader>> _shaders;
-        std::list<std::pair<GLuint, std::shared_ptr<ArrayBuffer>>>
+        std::list<std::pair<GLuint, std::shared_ptr<Buffer>>>
                 _activeAttributes;
+
+        GLint attributeLocation(const std::string &name);
         std::list<std::shared_ptr<Texture>> _activeTextures;
+        size_t _feedbackBuffers = 0;
+        GLenum _feedbackMode = GL_SEPARATE_ATTRIBS;
+        std::vector<size_t> _feedbackComponents;
+
+        /**
+         * Components captured per vertex into each feedback buffer, queried
+         * from the linked program.
+         */
+        void query_feedback_components();
+
+        static size_t components(GLenum type);
     };
 
     inline Shader::Shader(Shader::Type type, std::string source) : _type(type) {
@@ -286,7 +287,7 @@ namespace gpgpu {
         return loc;
     }
 
-    inline void Program::attribute(const std::string &name, std::shared_ptr<ArrayBuffer> buffer) {
+    inline GLint Program::attributeLocation(const std::string &name) {
         auto loc = glGetAttribLocation(_programID, name.c_str());
         assertNoGLError("glGetAttribLocation");
 
@@ -296,8 +297,37 @@ namespace gpgpu {
             throw ProgramError(s.str());
         }
 
+        return loc;
+    }
+
+    inline void Program::attribute(const std::string &name, std::shared_ptr<ArrayBuffer> buffer) {
+        auto loc = attributeLocation(name);
         buffer->bind(loc);
-        _activeAttributes.push_back(make_pair(loc, buffer));
+        _activeAttributes.push_back(std::make_pair(loc, buffer));
+    }
+
+    template<typename Format>
+    void Program::attributes(std::shared_ptr<VertexBuffer<Format>> buffer, std::initializer_list<std::string> names) {
+        if (names.size() != Format::attributes) {
+            std::stringstream s;
+            s << "Vertex format has " << Format::attributes << " attributes, got " << names.size() << " names.";
+            throw ProgramError(s.str());
+        }
+
+        GLint locations[Format::attributes + 1];
+        GLint *loc = locations;
+
+        for (const auto &name : names) {
+            *loc++ = name.empty() ? -1 : attributeLocation(name);
+        }
+
+        buffer->bind(locations);
+
+        for (size_t i = 0; i < Format::attributes; ++i) {
+            if (locations[i] >= 0) {
+                _activeAttributes.push_back(std::make_pair(locations[i], buffer));
+            }
+        }
     }
 
     inline void Program::uniform(const std::string &location, std::shared_ptr<Texture> texture) {
@@ -350,6 +380,24 @@ namespace gpgpu {
         }
     }
 
+    inline void Program::feedback_varyings(std::initializer_list<std::string> varyings, GLenum mode) {
+        std::vector<const GLchar *> names;
+        for (const auto &v : varyings) {
+            names.push_back(v.c_str());
+        }
+
+        glTransformFeedbackVaryings(_programID, names.size(), names.data(), mode);
+        assertNoGLError("glTransformFeedbackVaryings");
+
+        _feedbackBuffers = mode == GL_INTERLEAVED_ATTRIBS ? 1 : names.size();
+        _feedbackMode = mode;
+    }
+
+    inline void Program::set_separable(bool separable) {
+        glProgramParameteri(_programID, GL_PROGRAM_SEPARABLE, separable ? GL_TRUE : GL_FALSE);
+        assertNoGLError("glProgramParameteri");
+    }
+
     inline void Program::link() {
         glLinkProgram(_programID);
         assertNoGLError("glLinkProgram");
@@ -373,6 +421,76 @@ namespace gpgpu {
 
             throw ProgramError(msg);
         }
+
+        if (_feedbackBuffers > 0) {
+            query_feedback_components();
+        }
+    }
+
+    inline void Program::query_feedback_components() {
+        GLint varyings, length;
+        glGetProgramiv(_programID, GL_TRANSFORM_FEEDBACK_VARYINGS, &varyings);
+        glGetProgramiv(_programID, GL_TRANSFORM_FEEDBACK_VARYING_MAX_LENGTH, &length);
+        assertNoGLError("glGetProgramiv");
+
+        std::vector<GLchar> name(std::max(length, 1));
+        _feedbackComponents.assign(_feedbackBuffers, 0);
+
+        size_t buffer = 0;
+        for (GLint i = 0; i < varyings; ++i) {
+            GLsizei size;
+            GLenum type;
+            glGetTransformFeedbackVarying(_programID, i, name.size(), nullptr, &size, &type, name.data());
+            assertNoGLError("glGetTransformFeedbackVarying");
+
+            if (type == GL_NONE && size == 0) {
+                // gl_NextBuffer
+                ++buffer;
+                continue;
+            }
+
+            if (buffer < _feedbackComponents.size()) {
+                // gl_SkipComponents reports GL_NONE with the skipped count as size
+                _feedbackComponents[buffer] += type == GL_NONE ? size : size * components(type);
+            }
+
+            if (_feedbackMode == GL_SEPARATE_ATTRIBS) {
+                ++buffer;
+            }
+        }
+    }
+
+    inline size_t Program::components(GLenum type) {
+        switch (type) {
+            case GL_FLOAT_VEC2:
+            case GL_INT_VEC2:
+            case GL_UNSIGNED_INT_VEC2:
+                return 2;
+            case GL_FLOAT_VEC3:
+            case GL_INT_VEC3:
+            case GL_UNSIGNED_INT_VEC3:
+                return 3;
+            case GL_FLOAT_VEC4:
+            case GL_INT_VEC4:
+            case GL_UNSIGNED_INT_VEC4:
+            case GL_FLOAT_MAT2:
+                return 4;
+            case GL_FLOAT_MAT2x3:
+            case GL_FLOAT_MAT3x2:
+                return 6;
+            case GL_FLOAT_MAT2x4:
+            case GL_FLOAT_MAT4x2:
+                return 8;
+            case GL_FLOAT_MAT3:
+                return 9;
+            case GL_FLOAT_MAT3x4:
+            case GL_FLOAT_MAT4x3:
+                return 12;
+            case GL_FLOAT_MAT4:
+                return 16;
+            default:
+                return 1;
+        }
     }
 
     inline void Program::use() {
@@ -390,6 +508,66 @@ namespace gpgpu {
         assertNoGLError("glUniform1f");
     }
 
+    inline void Program::setUniformLocation(size_t location, size_t rows, size_t cols, const float *value,
+                                            size_t arrayLength) {
+        if (cols == 1) {
+            if (rows == 1) {
+                glUniform1fv(location, arrayLength, value);
+            } else if (rows == 2) {
+                glUniform2fv(location, arrayLength, value);
+            } else if (rows == 3) {
+                glUniform3fv(location, arrayLength, value);
+            } else if (rows == 4) {
+                glUniform4fv(location, arrayLength, value);
+            } else {
+                throw ProgramError::uniform(rows, cols, arrayLength);
+            }
+        } else if (cols == 2) {
+            if (rows == 2) {
+                glUniformMatrix2fv(location, arrayLength,
+                                   GL_FALSE, value);
+            } else if (rows == 3) {
+                glUniformMatrix2x3fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else if (rows == 4) {
+                glUniformMatrix2x4fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else {
+                throw ProgramError::uniform(rows, cols, arrayLength);
+            }
+        } else if (cols == 3) {
+            if (rows == 2) {
+                glUniformMatrix3x2fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else if (rows == 3) {
+                glUniformMatrix3fv(location, arrayLength,
+                                   GL_FALSE, value);
+            } else if (rows == 4) {
+                glUniformMatrix3x4fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else {
+                throw ProgramError::uniform(rows, cols, arrayLength);
+            }
+        } else if (cols == 4) {
+            if (rows == 2) {
+                glUniformMatrix4x2fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else if (rows == 3) {
+                glUniformMatrix4x3fv(location, arrayLength,
+                                     GL_FALSE, value);
+            } else if (rows == 4) {
+                glUniformMatrix4fv(location, arrayLength,
+                                   GL_FALSE, value);
+            } else {
+                throw ProgramError::uniform(rows, cols, arrayLength);
+            }
+        } else {
+            throw ProgramError::uniform(rows, cols, arrayLength);
+        }
+
+        assertNoGLError("setUniform(Eigen::Matrix)");
+    }
+
     inline void Program::render(const ElementArrayBuffer &faces) {
         enableAttributes();
         faces.bind();
@@ -407,6 +585,91 @@ namespace gpgpu {
 
         disableAttributesAndClear();
     }
+
+    template<typename Format>
+    void Program::render(std::shared_ptr<VertexBuffer<Format>> vertices, std::initializer_list<std::string> names,
+                         GLenum mode) {
+        attributes(vertices, names);
+        enableAttributes();
+
+        glDrawArrays(mode, 0, vertices->elements());
+        assertNoGLError("glDrawArrays");
+
+        disableAttributesAndClear();
+    }
+
+    inline void Program::transform(std::shared_ptr<ArrayBuffer> vertices, const std::string &location,
+                                   std::initializer_list<std::shared_ptr<ArrayBuffer>> outputs) {
+        if (_feedbackBuffers == 0 || outputs.size() != _feedbackBuffers) {
+            std::stringstream s;
+            s << "Transform feedback writes to " << _feedbackBuffers << " buffers, got " << outputs.size() << ".";
+            throw ProgramError(s.str());
+        }
+
+        size_t buffer = 0;
+        for (const auto &output : outputs) {
+            if (output->elements() < vertices->elements()) {
+                std::stringstream s;
+                s << "Transform feedback output holds " << output->elements() << " elements, needs " <<
+                        vertices->elements() << ".";
+                throw ProgramError(s.str());
+            }
+
+            const size_t captured = buffer < _feedbackComponents.size() ? _feedbackComponents[buffer] : 0;
+            if (output->dimension() != captured) {
+                std::stringstream s;
+                s << "Transform feedback buffer " << buffer << " captures " << captured <<
+                        " components per vertex, output has dimension " <<
+                        static_cast<unsigned>(output->dimension()) << ".";
+                throw ProgramError(s.str());
+            }
+            ++buffer;
+        }
+
+        GLuint index = 0;
+        bool active = false;
+        auto restore = [&]() {
+            if (active) {
+                glEndTransformFeedback();
+            }
+            glDisable(GL_RASTERIZER_DISCARD);
+
+            for (GLuint i = 0; i < index; ++i) {
+                glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, i, 0);
+            }
+        };
+
+        try {
+            attribute(location, vertices);
+            enableAttributes();
+
+            for (const auto &output : outputs) {
+                glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, index, output->id());
+                assertNoGLError("glBindBufferBase");
+                ++index;
+            }
+
+            glEnable(GL_RASTERIZER_DISCARD);
+            glBeginTransformFeedback(GL_POINTS);
+            assertNoGLError("glBeginTransformFeedback");
+            active = true;
+
+            glDrawArrays(GL_POINTS, 0, vertices->elements());
+            assertNoGLError("glDrawArrays");
+
+            active = false;
+            glEndTransformFeedback();
+            assertNoGLError("glEndTransformFeedback");
+        } catch (...) {
+            // leave no feedback active and rasterization enabled for the next draw
+            restore();
+            disableAttributesAndClear();
+            throw;
+        }
+
+        restore();
+        disableAttributesAndClear();
+    }
 }
 
 #endif /* GPGPU_OPENGL_PROGRAM_HPP */
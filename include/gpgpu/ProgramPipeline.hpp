@@ -0,0 +1,169 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_PROGRAMPIPELINE_HPP
+#define GPGPU_OPENGL_PROGRAMPIPELINE_HPP
+
+#include <initializer_list>
+#include <map>
+#include <memory>
+
+#include "OpenGLObject.hpp"
+#include "Program.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Links a single shader into a separable program, to be combined with
+     * other stages in a ProgramPipeline. GLSL 4.10+ vertex shaders need to
+     * redeclare `out gl_PerVertex { vec4 gl_Position; };`.
+     */
+    std::shared_ptr<Program> create_separable_program(std::initializer_list<std::shared_ptr<Shader>> shaders);
+
+    /**
+     * Combines separable programs per stage at draw time, so M vertex and
+     * N fragment programs are linked M + N instead of M * N times.
+     *
+     * Attributes and draws go through the program owning the vertex stage.
+     * Uniforms are set through the program selected with active().
+     */
+    class ProgramPipeline : public OpenGLObject {
+    public:
+        enum Stage {
+            VertexStage = GL_VERTEX_SHADER_BIT,
+            FragmentStage = GL_FRAGMENT_SHADER_BIT,
+            GeometryStage = GL_GEOMETRY_SHADER_BIT,
+            TessControlStage = GL_TESS_CONTROL_SHADER_BIT,
+            TessEvaluationStage = GL_TESS_EVALUATION_SHADER_BIT,
+            ComputeStage = GL_COMPUTE_SHADER_BIT
+        };
+
+        ProgramPipeline();
+
+        ~ProgramPipeline();
+
+        ProgramPipeline(const ProgramPipeline &) = delete;
+
+        ProgramPipeline &operator=(const ProgramPipeline &) = delete;
+
+        GLuint id() const {
+            return _id;
+        }
+
+        /**
+         * @param stages Stage bits, e.g. VertexStage | FragmentStage.
+         */
+        void use_stages(GLbitfield stages, std::shared_ptr<Program> program);
+
+        /**
+         * Unbinds any program from glUseProgram, which would take precedence over the pipeline.
+         */
+        void bind();
+
+        /**
+         * Directs Program::uniform calls to `program`.
+         */
+        void active(std::shared_ptr<Program> program);
+
+        /**
+         * @throws ProgramError if the stage interfaces don't match.
+         */
+        void validate();
+
+    protected:
+        GLuint _id;
+        std::map<GLbitfield, std::shared_ptr<Program>> _stages;
+    };
+
+
+    /*
+     * Definition
+     */
+    inline std::shared_ptr<Program> create_separable_program(std::initializer_list<std::shared_ptr<Shader>> shaders) {
+        auto program = std::make_shared<Program>();
+        program->set_separable();
+        program->append(shaders);
+        program->link();
+        return program;
+    }
+
+    inline ProgramPipeline::ProgramPipeline() {
+        glGenProgramPipelines(1, &_id);
+        assertNoGLError("glGenProgramPipelines");
+    }
+
+    inline ProgramPipeline::~ProgramPipeline() {
+        glDeleteProgramPipelines(1, &_id);
+    }
+
+    inline void ProgramPipeline::use_stages(GLbitfield stages, std::shared_ptr<Program> program) {
+        glUseProgramStages(_id, stages, program->id());
+        assertNoGLError("glUseProgramStages");
+
+        // Keep stage programs alive for as long as the pipeline references them.
+        for (GLbitfield bit = 1; bit != 0 && bit <= stages; bit <<= 1) {
+            if (stages & bit) {
+                _stages[bit] = program;
+            }
+        }
+    }
+
+    inline void ProgramPipeline::bind() {
+        glUseProgram(0);
+        glBindProgramPipeline(_id);
+        assertNoGLError("glBindProgramPipeline");
+    }
+
+    inline void ProgramPipeline::active(std::shared_ptr<Program> program) {
+        glActiveShaderProgram(_id, program->id());
+        assertNoGLError("glActiveShaderProgram");
+    }
+
+    inline void ProgramPipeline::validate() {
+        glValidateProgramPipeline(_id);
+        assertNoGLError("glValidateProgramPipeline");
+
+        GLint status;
+        glGetProgramPipelineiv(_id, GL_VALIDATE_STATUS, &status);
+        assertNoGLError("glGetProgramPipelineiv");
+
+        if (status != GL_TRUE) {
+            GLint length = 0;
+            glGetProgramPipelineiv(_id, GL_INFO_LOG_LENGTH, &length);
+
+            std::string msg = "Program pipeline is not valid.";
+
+            if (length > 1) {
+                std::vector<GLchar> error(length);
+                glGetProgramPipelineInfoLog(_id, length, nullptr, error.data());
+                msg = std::string(error.data());
+            }
+
+            throw ProgramError(msg);
+        }
+    }
+}
+
+#endif /* GPGPU_OPENGL_PROGRAMPIPELINE_HPP */
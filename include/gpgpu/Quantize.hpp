@@ -0,0 +1,196 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_QUANTIZE_HPP
+#define GPGPU_QUANTIZE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+namespace gpgpu {
+    /*
+     * Declaration
+     *
+     * Conversions of float streams to compact vertex attribute types,
+     * vectorized with SSE2/AVX2 (F16C for half floats) when the compiler
+     * targets them, e.g. with -march=native. Rounding is to nearest, as
+     * OpenGL expects for normalized values.
+     */
+
+    /**
+     * IEEE 754 binary16, bound as Buffer::HalfFloat.
+     */
+    void quantize_half(const float *in, uint16_t *out, size_t n);
+
+    /**
+     * [-1, 1] to signed 16 bit, bound as normalized Buffer::Short.
+     */
+    void quantize_snorm16(const float *in, int16_t *out, size_t n);
+
+    /**
+     * [0, 1] to unsigned 8 bit, bound as normalized Buffer::UnsignedByte.
+     */
+    void quantize_unorm8(const float *in, uint8_t *out, size_t n);
+
+    uint16_t float_to_half(float value);
+
+
+    /*
+     * Definition
+     */
+    inline uint16_t float_to_half(float value) {
+        uint32_t f;
+        std::memcpy(&f, &value, sizeof(f));
+
+        const uint32_t sign = (f >> 16) & 0x8000;
+        const uint32_t abs = f & 0x7fffffff;
+
+        if (abs >= 0x7f800000) {
+            // Inf stays Inf, NaN stays a (quiet) NaN.
+            return static_cast<uint16_t>(sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 : 0));
+        }
+
+        if (abs >= 0x477ff000) {
+            // Rounds to a value beyond the largest half (65504).
+            return static_cast<uint16_t>(sign | 0x7c00);
+        }
+
+        if (abs < 0x38800000) {
+            // Subnormal half, shift the mantissa with its implicit bit into place and round to nearest even.
+            if (abs < 0x33000000) {
+                return static_cast<uint16_t>(sign);
+            }
+
+            const uint32_t mantissa = (abs & 0x007fffff) | 0x00800000;
+            const uint32_t shift = 126 - (abs >> 23);
+            uint32_t half = mantissa >> shift;
+            const uint32_t rest = mantissa & ((1u << shift) - 1);
+            const uint32_t halfway = 1u << (shift - 1);
+
+            if (rest > halfway || (rest == halfway && (half & 1))) {
+                ++half;
+            }
+
+            return static_cast<uint16_t>(sign | half);
+        }
+
+        // Normal half: rebias the exponent, round to nearest even on the 13 dropped bits.
+        uint32_t half = (abs - 0x38000000) >> 13;
+        const uint32_t rest = abs & 0x1fff;
+
+        if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+            ++half;
+        }
+
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    inline void quantize_half(const float *in, uint16_t *out, size_t n) {
+        size_t i = 0;
+
+#if defined(__F16C__) && defined(__AVX__)
+        for (; i + 8 <= n; i += 8) {
+            const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), h);
+        }
+#endif
+
+        for (; i < n; ++i) {
+            out[i] = float_to_half(in[i]);
+        }
+    }
+
+    inline void quantize_snorm16(const float *in, int16_t *out, size_t n) {
+        size_t i = 0;
+
+#if defined(__AVX2__)
+        {
+            const __m256 lo = _mm256_set1_ps(-1.0f), hi = _mm256_set1_ps(1.0f), scale = _mm256_set1_ps(32767.0f);
+
+            for (; i + 16 <= n; i += 16) {
+                const __m256i a = _mm256_cvtps_epi32(
+                        _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i), lo), hi), scale));
+                const __m256i b = _mm256_cvtps_epi32(
+                        _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(in + i + 8), lo), hi), scale));
+
+                // packs works per 128 bit lane, restore the element order afterwards.
+                const __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(a, b), 0xd8);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), packed);
+            }
+        }
+#endif
+
+#if defined(__SSE2__)
+        {
+            const __m128 lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(32767.0f);
+
+            for (; i + 8 <= n; i += 8) {
+                const __m128i a = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i), lo), hi), scale));
+                const __m128i b = _mm_cvtps_epi32(
+                        _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4), lo), hi), scale));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), _mm_packs_epi32(a, b));
+            }
+        }
+#endif
+
+        for (; i < n; ++i) {
+            // !(x >= -1) also maps NaN to -1, like the min/max above.
+            const float v = !(in[i] >= -1.0f) ? -1.0f : std::min(in[i], 1.0f);
+            out[i] = static_cast<int16_t>(std::lrint(v * 32767.0f));
+        }
+    }
+
+    inline void quantize_unorm8(const float *in, uint8_t *out, size_t n) {
+        size_t i = 0;
+
+#if defined(__SSE2__)
+        {
+            const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(1.0f), scale = _mm_set1_ps(255.0f);
+
+            for (; i + 16 <= n; i += 16) {
+                __m128i v[4];
+
+                for (int k = 0; k < 4; ++k) {
+                    v[k] = _mm_cvtps_epi32(
+                            _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(in + i + 4 * k), lo), hi), scale));
+                }
+
+                const __m128i packed = _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]), _mm_packs_epi32(v[2], v[3]));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), packed);
+            }
+        }
+#endif
+
+        for (; i < n; ++i) {
+            const float v = !(in[i] >= 0.0f) ? 0.0f : std::min(in[i], 1.0f);
+            out[i] = static_cast<uint8_t>(std::lrint(v * 255.0f));
+        }
+    }
+}
+
+#endif /* GPGPU_QUANTIZE_HPP */
@@ -0,0 +1,293 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_QUERY_HPP
+#define GPGPU_OPENGL_QUERY_HPP
+
+#include <memory>
+#include <vector>
+
+#include "OpenGLObject.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Counts (or detects) samples passing the depth test between begin()
+     * and end(), e.g. around Program::render of an object or its bounding
+     * proxy.
+     */
+    class OcclusionQuery : public OpenGLObject {
+    public:
+        enum Type {
+            AnySamplesPassed = GL_ANY_SAMPLES_PASSED,
+            SamplesPassed = GL_SAMPLES_PASSED
+        };
+
+        /**
+         * begin() on construction, ends the query on destruction without
+         * checking for GL errors, destructors must not throw.
+         */
+        class Scope {
+        public:
+            explicit Scope(OcclusionQuery &query) : _query(query) {
+                _query.begin();
+            }
+
+            ~Scope() {
+                glEndQuery(_query._type);
+                _query._ended = true;
+            }
+
+            Scope(const Scope &) = delete;
+
+            Scope &operator=(const Scope &) = delete;
+
+        private:
+            OcclusionQuery &_query;
+        };
+
+        explicit OcclusionQuery(Type type = AnySamplesPassed);
+
+        ~OcclusionQuery();
+
+        OcclusionQuery(const OcclusionQuery &) = delete;
+
+        OcclusionQuery &operator=(const OcclusionQuery &) = delete;
+
+        GLuint id() const {
+            return _id;
+        }
+
+        Type type() const {
+            return _type;
+        }
+
+        void begin();
+
+        void end();
+
+        /**
+         * Whether end() was called since the last begin(), only then a
+         * result can be polled.
+         */
+        bool ended() const {
+            return _ended;
+        }
+
+        /**
+         * True once the result can be read without stalling.
+         */
+        bool available();
+
+        /**
+         * Sample count (SamplesPassed) or 0/1 (AnySamplesPassed), blocks until available.
+         */
+        GLuint64 result();
+
+    protected:
+        friend class PipelinedOcclusionQuery;
+
+        GLuint _id;
+        Type _type;
+        bool _ended = false;
+    };
+
+    /**
+     * Skips the draws issued during its lifetime if the query's samples
+     * didn't pass, decided on the GPU without reading the result back.
+     */
+    class ConditionalRender {
+    public:
+        enum Mode {
+            Wait = GL_QUERY_WAIT,
+            NoWait = GL_QUERY_NO_WAIT,
+            ByRegionWait = GL_QUERY_BY_REGION_WAIT,
+            ByRegionNoWait = GL_QUERY_BY_REGION_NO_WAIT
+        };
+
+        /**
+         * @param mode NoWait draws if the result isn't known yet instead of stalling the GPU.
+         */
+        explicit ConditionalRender(const OcclusionQuery &query, Mode mode = Wait) {
+            glBeginConditionalRender(query.id(), mode);
+        }
+
+        ~ConditionalRender() {
+            glEndConditionalRender();
+        }
+
+        ConditionalRender(const ConditionalRender &) = delete;
+
+        ConditionalRender &operator=(const ConditionalRender &) = delete;
+    };
+
+    /**
+     * Disables color and depth writes during its lifetime, for bounding
+     * proxies that should only be tested against the depth buffer.
+     */
+    class ProxyPass {
+    public:
+        ProxyPass() {
+            glGetBooleanv(GL_COLOR_WRITEMASK, _color);
+            glGetBooleanv(GL_DEPTH_WRITEMASK, &_depth);
+
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glDepthMask(GL_FALSE);
+        }
+
+        ~ProxyPass() {
+            glColorMask(_color[0], _color[1], _color[2], _color[3]);
+            glDepthMask(_depth);
+        }
+
+        ProxyPass(const ProxyPass &) = delete;
+
+        ProxyPass &operator=(const ProxyPass &) = delete;
+
+    private:
+        GLboolean _color[4];
+        GLboolean _depth;
+    };
+
+    /**
+     * Ring of occlusion queries for one object, issued once per frame and
+     * read a few frames later so culling decisions never wait for the GPU:
+     *
+     *   if (query.visible()) { OcclusionQuery::Scope s(query.next()); render(object); }
+     *   else { ProxyPass p; OcclusionQuery::Scope s(query.next()); render(bounds); }
+     *
+     * Objects count as visible until their first result arrives.
+     */
+    class PipelinedOcclusionQuery {
+    public:
+        explicit PipelinedOcclusionQuery(size_t frames = 3, OcclusionQuery::Type type = OcclusionQuery::AnySamplesPassed);
+
+        /**
+         * Query to issue for the current frame. Reuses the oldest one, its
+         * result is dropped if it still hasn't arrived.
+         */
+        OcclusionQuery &next();
+
+        /**
+         * Newest available result, never blocks.
+         */
+        GLuint64 samples();
+
+        bool visible() {
+            return samples() > 0;
+        }
+
+    protected:
+        std::vector<std::unique_ptr<OcclusionQuery>> _queries;
+        std::vector<bool> _issued;
+        size_t _next = 0;
+        GLuint64 _samples = 1;
+    };
+
+
+    /*
+     * Definition
+     */
+    inline OcclusionQuery::OcclusionQuery(Type type) : _type(type) {
+        glGenQueries(1, &_id);
+        assertNoGLError("glGenQueries");
+    }
+
+    inline OcclusionQuery::~OcclusionQuery() {
+        glDeleteQueries(1, &_id);
+    }
+
+    inline void OcclusionQuery::begin() {
+        _ended = false;
+        glBeginQuery(_type, _id);
+        assertNoGLError("glBeginQuery");
+    }
+
+    inline void OcclusionQuery::end() {
+        glEndQuery(_type);
+        assertNoGLError("glEndQuery");
+        _ended = true;
+    }
+
+    inline bool OcclusionQuery::available() {
+        GLuint available;
+        glGetQueryObjectuiv(_id, GL_QUERY_RESULT_AVAILABLE, &available);
+        assertNoGLError("glGetQueryObjectuiv");
+        return available == GL_TRUE;
+    }
+
+    inline GLuint64 OcclusionQuery::result() {
+        GLuint64 result;
+        glGetQueryObjectui64v(_id, GL_QUERY_RESULT, &result);
+        assertNoGLError("glGetQueryObjectui64v");
+        return result;
+    }
+
+    inline PipelinedOcclusionQuery::PipelinedOcclusionQuery(size_t frames, OcclusionQuery::Type type)
+            : _issued(frames < 1 ? 1 : frames, false) {
+        for (size_t i = 0; i < _issued.size(); ++i) {
+            _queries.emplace_back(new OcclusionQuery(type));
+        }
+    }
+
+    inline OcclusionQuery &PipelinedOcclusionQuery::next() {
+        // Collect the result of the query about to be reused if it's there anyway.
+        samples();
+
+        // Issued once the caller ended it, until then polling it would be invalid.
+        auto &query = *_queries[_next];
+        query._ended = false;
+        _issued[_next] = true;
+        _next = (_next + 1) % _queries.size();
+        return query;
+    }
+
+    inline GLuint64 PipelinedOcclusionQuery::samples() {
+        /*
+         * Walk from the newest issued query back to the oldest, the first
+         * available one is the most recent result.
+         */
+        const size_t n = _queries.size();
+
+        for (size_t k = 1; k <= n; ++k) {
+            const size_t i = (_next + n - k) % n;
+
+            if (_issued[i] && _queries[i]->ended() && _queries[i]->available()) {
+                _samples = _queries[i]->result();
+
+                // Older queries can't carry newer information.
+                for (size_t j = k; j <= n; ++j) {
+                    _issued[(_next + n - j) % n] = false;
+                }
+
+                break;
+            }
+        }
+
+        return _samples;
+    }
+}
+
+#endif /* GPGPU_OPENGL_QUERY_HPP */
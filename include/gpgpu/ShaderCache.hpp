@@ -0,0 +1,360 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_SHADERCACHE_HPP
+#define GPGPU_OPENGL_SHADERCACHE_HPP
+
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "Program.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Preprocessor defines and constants that specialize a shader source.
+     * Ordered by name, so equal sets produce equal keys regardless of the
+     * order they were added in.
+     */
+    class ShaderDefines {
+    public:
+        ShaderDefines() = default;
+
+        ShaderDefines(std::initializer_list<std::pair<const std::string, std::string>> defines)
+                : _defines(defines) {
+
+        }
+
+        /**
+         * Adds `#define name value`.
+         */
+        ShaderDefines &define(const std::string &name, const std::string &value = "");
+
+        ShaderDefines &define(const std::string &name, int value) {
+            return define(name, std::to_string(value));
+        }
+
+        /**
+         * Adds `const type name = value;`, e.g. constant("float", "SIGMA", "1.5").
+         */
+        ShaderDefines &constant(const std::string &type, const std::string &name, const std::string &value);
+
+        /**
+         * Lines injected after `#version` and `#extension`, also the cache key.
+         */
+        const std::string &preamble() const;
+
+    protected:
+        std::map<std::string, std::string> _defines;
+        std::map<std::string, std::pair<std::string, std::string>> _constants;
+        mutable std::string _preamble;
+        mutable bool _dirty = true;
+    };
+
+    /**
+     * Inserts the preamble after the `#version` and `#extension` lines at
+     * the top (or at the very top without them), followed by a #line
+     * directive so compiler messages keep pointing at lines of the
+     * original source.
+     */
+    std::string inject_defines(const std::string &source, const ShaderDefines &defines);
+
+    inline std::shared_ptr<Shader> create_shader(Shader::Type type, const std::string &source,
+                                                 const ShaderDefines &defines) {
+        return create_shader(type, inject_defines(source, defines));
+    }
+
+    /**
+     * Shader source specialized through ShaderDefines, hashed once.
+     */
+    class ShaderTemplate {
+    public:
+        ShaderTemplate(Shader::Type type, std::string source)
+                : _type(type), _source(std::move(source)),
+                  _hash(std::hash<std::string>()(_source) ^ (static_cast<size_t>(type) << 1)) {
+
+        }
+
+        Shader::Type type() const {
+            return _type;
+        }
+
+        const std::string &source() const {
+            return _source;
+        }
+
+        size_t hash() const {
+            return _hash;
+        }
+
+    protected:
+        Shader::Type _type;
+        std::string _source;
+        size_t _hash;
+    };
+
+    /**
+     * Compiled shader and linked program variants, keyed by the template
+     * sources and the define set. Keys are ordered by the template hashes
+     * first, so repeated requests for a variant cost a map lookup and one
+     * comparison of the sources.
+     */
+    class ShaderCache {
+    public:
+        std::shared_ptr<Shader> shader(const ShaderTemplate &source, const ShaderDefines &defines = ShaderDefines());
+
+        /**
+         * Links all stages with the same define set.
+         */
+        std::shared_ptr<Program> program(std::initializer_list<const ShaderTemplate *> stages,
+                                         const ShaderDefines &defines = ShaderDefines());
+
+        size_t shaders() const {
+            return _shaders.size();
+        }
+
+        size_t programs() const {
+            return _programs.size();
+        }
+
+        /**
+         * Keeps at most `programs` linked programs (0 for no limit, the
+         * default), evicting the least recently used one. Under a cap,
+         * shaders are only kept while a cached program (or the caller)
+         * still uses them.
+         */
+        void set_capacity(size_t programs) {
+            _capacity = programs;
+            evict();
+        }
+
+        size_t capacity() const {
+            return _capacity;
+        }
+
+        void clear() {
+            _programs.clear();
+            _shaders.clear();
+        }
+
+    protected:
+        struct CachedProgram {
+            std::shared_ptr<Program> program;
+            uint64_t used;
+        };
+
+        // Hash, stage and source of a template, the source tells colliding hashes apart.
+        typedef std::tuple<size_t, Shader::Type, std::string> SourceKey;
+
+        std::map<std::pair<SourceKey, std::string>, std::shared_ptr<Shader>> _shaders;
+        std::map<std::pair<std::vector<SourceKey>, std::string>, CachedProgram> _programs;
+        size_t _capacity = 0;
+        uint64_t _uses = 0;
+
+        void evict();
+
+        void drop_unused_shaders();
+    };
+
+
+    /*
+     * Definition
+     */
+    inline ShaderDefines &ShaderDefines::define(const std::string &name, const std::string &value) {
+        _defines[name] = value;
+        _dirty = true;
+        return *this;
+    }
+
+    inline ShaderDefines &ShaderDefines::constant(const std::string &type, const std::string &name,
+                                                  const std::string &value) {
+        _constants[name] = std::make_pair(type, value);
+        _dirty = true;
+        return *this;
+    }
+
+    inline const std::string &ShaderDefines::preamble() const {
+        if (_dirty) {
+            std::stringstream s;
+
+            for (const auto &d : _defines) {
+                s << "#define " << d.first;
+
+                if (!d.second.empty()) {
+                    s << " " << d.second;
+                }
+
+                s << "\n";
+            }
+
+            for (const auto &c : _constants) {
+                s << "const " << c.second.first << " " << c.first << " = " << c.second.second << ";\n";
+            }
+
+            _preamble = s.str();
+            _dirty = false;
+        }
+
+        return _preamble;
+    }
+
+    inline std::string inject_defines(const std::string &source, const ShaderDefines &defines) {
+        const auto &preamble = defines.preamble();
+
+        if (preamble.empty()) {
+            return source;
+        }
+
+        /*
+         * Find the leading #version and #extension directives, only whitespace may precede them on
+         * their lines. Constants are declarations, and #extension has to come before any of those.
+         */
+        size_t insert = 0;
+        size_t line = 1;
+        size_t begin = 0;
+
+        for (size_t number = 1; begin < source.size(); ++number) {
+            auto end = source.find('\n', begin);
+            if (end == std::string::npos) {
+                end = source.size();
+            }
+
+            const auto first = source.find_first_not_of(" \t\r", begin);
+            const bool blank = first == std::string::npos || first >= end;
+
+            if (!blank && (source.compare(first, 8, "#version") == 0 ||
+                           source.compare(first, 10, "#extension") == 0)) {
+                insert = end < source.size() ? end + 1 : end;
+                line = number + 1;
+            } else if (!blank && source.compare(first, 2, "//") != 0) {
+                break;
+            }
+
+            begin = end + 1;
+        }
+
+        std::stringstream s;
+        s << source.substr(0, insert);
+
+        if (insert > 0 && source[insert - 1] != '\n') {
+            s << "\n";
+        }
+
+        s << preamble << "#line " << line << "\n" << source.substr(insert);
+        return s.str();
+    }
+
+    inline std::shared_ptr<Shader> ShaderCache::shader(const ShaderTemplate &source, const ShaderDefines &defines) {
+        auto key = std::make_pair(SourceKey(source.hash(), source.type(), source.source()), defines.preamble());
+        auto it = _shaders.find(key);
+
+        if (it != _shaders.end()) {
+            return it->second;
+        }
+
+        auto shader = create_shader(source.type(), source.source(), defines);
+        _shaders.emplace(std::move(key), shader);
+        return shader;
+    }
+
+    inline std::shared_ptr<Program> ShaderCache::program(std::initializer_list<const ShaderTemplate *> stages,
+                                                         const ShaderDefines &defines) {
+        std::vector<SourceKey> sources;
+        for (auto stage : stages) {
+            sources.emplace_back(stage->hash(), stage->type(), stage->source());
+        }
+
+        auto key = std::make_pair(std::move(sources), defines.preamble());
+        auto it = _programs.find(key);
+
+        if (it != _programs.end()) {
+            it->second.used = ++_uses;
+            return it->second.program;
+        }
+
+        auto program = std::make_shared<Program>();
+
+        try {
+            for (auto stage : stages) {
+                program->append(shader(*stage, defines));
+            }
+
+            program->link();
+        } catch (...) {
+            // Don't keep the stages of programs that failed to link around under a cap.
+            if (_capacity != 0) {
+                program.reset();
+                drop_unused_shaders();
+            }
+
+            throw;
+        }
+
+        _programs.emplace(std::move(key), CachedProgram{program, ++_uses});
+        evict();
+        return program;
+    }
+
+    inline void ShaderCache::evict() {
+        if (_capacity == 0 || _programs.size() <= _capacity) {
+            return;
+        }
+
+        while (_programs.size() > _capacity) {
+            auto oldest = _programs.begin();
+
+            for (auto it = _programs.begin(); it != _programs.end(); ++it) {
+                if (it->second.used < oldest->second.used) {
+                    oldest = it;
+                }
+            }
+
+            _programs.erase(oldest);
+        }
+
+        drop_unused_shaders();
+    }
+
+    inline void ShaderCache::drop_unused_shaders() {
+        // Shaders only the cache still holds belonged to evicted programs.
+        for (auto it = _shaders.begin(); it != _shaders.end();) {
+            if (it->second.use_count() == 1) {
+                it = _shaders.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_OPENGL_SHADERCACHE_HPP */
@@ -24,7 +24,9 @@
 #define GPGPU_OPENGL_TEXTURE_HPP
 
 #include "OpenGLObject.hpp"
+#include "MemoryTracker.hpp"
 
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
 #include <memory>
@@ -43,13 +45,48 @@ namespace gpgpu {
 
     class Texture : public OpenGLObject {
     public:
+        /**
+         * Row order of read back images. OpenGL stores the bottom row first,
+         * image files and OpenImageIO expect the top row first.
+         */
+        enum Orientation {
+            BottomUp,
+            TopDown
+        };
+
+        /**
+         * Rectangle in texels, x and y count from the first row in storage
+         * (the bottom row of a rendered image).
+         */
+        struct Region {
+            unsigned int x;
+            unsigned int y;
+            unsigned int width;
+            unsigned int height;
+
+            Region(unsigned int x, unsigned int y, unsigned int width, unsigned int height)
+                    : x(x), y(y), width(width), height(height) {
+
+            }
+
+            size_t texels() const {
+                return size_t(width) * height;
+            }
+        };
+
         Texture(GLenum target) {
             glGenTextures(1, &_id);
             _target = target;
+
+            glBindTexture(_target, _id);
             set_filter(GL_LINEAR);
         }
 
         virtual ~Texture() {
+            if (_read_framebuffer != 0) {
+                glDeleteFramebuffers(1, &_read_framebuffer);
+            }
+
             glDeleteTextures(1, &_id);
         }
 
@@ -77,9 +114,264 @@ namespace gpgpu {
             assertNoGLError("glBindTexture");
         }
 
+        /**
+         * Groups the texture's memory under `label` in MemoryTracker statistics.
+         */
+        virtual void label(const std::string &label) {
+            _memory.label(label);
+        }
+
+        /**
+         * Approximate bytes per texel the driver allocates for `internalFormat`.
+         */
+        static size_t texel_size(GLenum internalFormat) {
+            switch (internalFormat) {
+                case GL_R8:
+                case GL_RED:
+                case GL_STENCIL_INDEX8:
+                    return 1;
+                case GL_RG8:
+                case GL_RG:
+                case GL_R16F:
+                case GL_R16:
+                case GL_DEPTH_COMPONENT16:
+                    return 2;
+                case GL_RGB16F:
+                case GL_RGBA16F:
+                case GL_RGBA16:
+                case GL_RG32F:
+                case GL_DEPTH32F_STENCIL8:
+                    return 8;
+                case GL_RGB32F:
+                case GL_RGBA32F:
+                    return 16;
+                default:
+                    // RGB(A)8, BGRA, RG16(F), R32F and 24/32 bit depth formats, RGB is padded by most drivers.
+                    return 4;
+            }
+        }
+
+        /**
+         * Pixel transfer format for images with 1 to 4 channels.
+         */
+        static GLenum pixel_format(int channels) {
+            switch (channels) {
+                case 1:
+                    return GL_RED;
+                case 2:
+                    return GL_RG;
+                case 3:
+                    return GL_RGB;
+                case 4:
+                    return GL_RGBA;
+                default:
+                    std::stringstream msg;
+                    msg << "Images with " << channels << " channels can't be transferred.";
+                    throw TextureError(msg.str());
+            }
+        }
+
+        /**
+         * Pixel transfer type for 8/16 bit unsigned, half and float images.
+         */
+        static GLenum pixel_type(OpenImageIO::TypeDesc format) {
+            switch (format.basetype) {
+                case OpenImageIO::TypeDesc::UINT8:
+                    return GL_UNSIGNED_BYTE;
+                case OpenImageIO::TypeDesc::UINT16:
+                    return GL_UNSIGNED_SHORT;
+                case OpenImageIO::TypeDesc::HALF:
+                    return GL_HALF_FLOAT;
+                case OpenImageIO::TypeDesc::FLOAT:
+                    return GL_FLOAT;
+                default:
+                    throw TextureError("Pixel type must be 8 or 16 bit unsigned, half or float.");
+            }
+        }
+
+        /**
+         * Pixels of an image held in memory, file or cache backed images
+         * have none and need to be read into local storage first.
+         */
+        static const void *local_pixels(const OpenImageIO::ImageBuf &image) {
+            const void *pixels = image.localpixels();
+            if (pixels == nullptr) {
+                throw TextureError("Image has no local pixels (file or cache backed), copy it into memory first.");
+            }
+            return pixels;
+        }
+
+        static void *local_pixels(OpenImageIO::ImageBuf &image) {
+            return const_cast<void *>(local_pixels(static_cast<const OpenImageIO::ImageBuf &>(image)));
+        }
+
+        /**
+         * Bytes per pixel of client memory in `format` and `type`.
+         */
+        static size_t pixel_size(GLenum format, GLenum type) {
+            size_t channels;
+
+            switch (format) {
+                case GL_RED:
+                case GL_DEPTH_COMPONENT:
+                    channels = 1;
+                    break;
+                case GL_RG:
+                    channels = 2;
+                    break;
+                case GL_RGB:
+                case GL_BGR:
+                    channels = 3;
+                    break;
+                case GL_RGBA:
+                case GL_BGRA:
+                    channels = 4;
+                    break;
+                default:
+                    std::stringstream msg;
+                    msg << "Unsupported pixel format 0x" << std::hex << format << ".";
+                    throw TextureError(msg.str());
+            }
+
+            switch (type) {
+                case GL_UNSIGNED_BYTE:
+                case GL_BYTE:
+                    return channels;
+                case GL_UNSIGNED_SHORT:
+                case GL_SHORT:
+                case GL_HALF_FLOAT:
+                    return channels * 2;
+                case GL_UNSIGNED_INT:
+                case GL_INT:
+                case GL_FLOAT:
+                    return channels * 4;
+                default:
+                    std::stringstream msg;
+                    msg << "Unsupported pixel type 0x" << std::hex << type << ".";
+                    throw TextureError(msg.str());
+            }
+        }
+
+    protected:
+        MemoryAllocation _memory{MemoryTracker::TextureMemory};
+
+        /**
+         * Sets the pixel pack state of a download and resets it to the
+         * defaults when it goes out of scope, also if a GL error throws.
+         */
+        class PackState {
+        public:
+            PackState(GLint alignment, GLint row_length, GLint image_height = 0) {
+                glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+                glPixelStorei(GL_PACK_ROW_LENGTH, row_length);
+                glPixelStorei(GL_PACK_IMAGE_HEIGHT, image_height);
+            }
+
+            ~PackState() {
+                glPixelStorei(GL_PACK_IMAGE_HEIGHT, 0);
+                glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            }
+
+            PackState(const PackState &) = delete;
+
+            PackState &operator=(const PackState &) = delete;
+        };
+
+        /**
+         * Row length in pixels for GL_PACK/UNPACK_ROW_LENGTH, 0 for tightly packed rows.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         */
+        static GLint row_length(size_t stride, size_t pixel, unsigned int width) {
+            if (stride != 0 && (stride % pixel != 0 || stride < width * pixel)) {
+                std::stringstream msg;
+                msg << "Row stride (" << stride << ") must be a multiple of " << pixel <<
+                        " and at least " << width * pixel << " bytes.";
+                throw TextureError(msg.str());
+            }
+
+            return static_cast<GLint>(stride / pixel);
+        }
+
+        /**
+         * Rows per layer for GL_PACK/UNPACK_IMAGE_HEIGHT, 0 for tightly packed layers.
+         *
+         * @param layer_stride Bytes between the first pixels of two layers, 0 if tightly packed.
+         */
+        static GLint image_height(size_t layer_stride, size_t row_stride, unsigned int height) {
+            if (layer_stride != 0 && (layer_stride % row_stride != 0 || layer_stride < height * row_stride)) {
+                std::stringstream msg;
+                msg << "Layer stride (" << layer_stride << ") must be a multiple of the row stride (" <<
+                        row_stride << ") and at least " << height * row_stride << " bytes.";
+                throw TextureError(msg.str());
+            }
+
+            return static_cast<GLint>(layer_stride / row_stride);
+        }
+
+        static void assert_region(const Region &region, const OpenImageIO::ImageSpec &s) {
+            const auto width = static_cast<unsigned int>(s.width);
+            const auto height = static_cast<unsigned int>(s.height);
+
+            // compared without adding, x + width can wrap
+            if (region.width == 0 || region.height == 0 ||
+                region.x >= width || region.width > width - region.x ||
+                region.y >= height || region.height > height - region.y) {
+                std::stringstream msg;
+                msg << "Region " << region.width << "x" << region.height << "+" << region.x << "+" << region.y <<
+                        " is empty or exceeds the texture (" << s.width << "x" << s.height << ").";
+                throw TextureError(msg.str());
+            }
+        }
+
+        /**
+         * Attaches level 0 (of `layer` for arrays) to a read framebuffer kept
+         * for the lifetime of the texture and binds it.
+         *
+         * @return The previous read framebuffer binding, to be restored.
+         */
+        GLint bind_read_framebuffer(GLint layer = -1) {
+            GLint previous;
+            glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous);
+
+            if (_read_framebuffer == 0) {
+                glGenFramebuffers(1, &_read_framebuffer);
+                assertNoGLError("glGenFramebuffers");
+            }
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, _read_framebuffer);
+
+            if (layer < 0) {
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _target, _id, 0);
+            } else {
+                glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, _id, 0, layer);
+            }
+
+            try {
+                assertNoGLError("glFramebufferTexture");
+            } catch (...) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+                throw;
+            }
+
+            glReadBuffer(GL_COLOR_ATTACHMENT0);
+            return previous;
+        }
+
+        void assert_readable() const {
+            GLint internalFormat;
+            glGetTexLevelParameteriv(target(), 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+
+            if (internalFormat != GL_RGBA && internalFormat != GL_BGRA) {
+                throw TextureError("Internal format must be GL_RGBA or GL_BGRA to extract image.");
+            }
+        }
+
     private:
         GLuint _id;
         GLenum _target;
+        GLuint _read_framebuffer = 0;
     };
 
     class Texture2D : public Texture {
@@ -89,29 +381,235 @@ namespace gpgpu {
                   GLenum format = DEFAULT_TEXTURE_FORMAT,
                   GLenum type = DEFAULT_TEXTURE_TYPE) : Texture(GL_TEXTURE_2D) {
 
+            _memory.resize(size_t(width) * height * texel_size(internalFormat));
+
             glBindTexture(target(), id());
             glTexImage2D(target(), 0, internalFormat, width, height, 0, format, type, nullptr);
             assertNoGLError("glTexImage2D");
         }
 
-        std::shared_ptr <OpenImageIO::ImageBuf> image() {
+        ~Texture2D() {
+            if (_flip_framebuffers[0] != 0) {
+                glDeleteFramebuffers(2, _flip_framebuffers);
+                glDeleteRenderbuffers(1, &_flip_renderbuffer);
+            }
+        }
+
+        /**
+         * Reads a depth texture as one float channel in [0, 1], rows bottom-up.
+         */
+        std::shared_ptr <OpenImageIO::ImageBuf> depth_image() {
+            const auto s = size();
+            auto buffer = std::make_shared<OpenImageIO::ImageBuf>(
+                    "depth", OpenImageIO::ImageSpec(s.width, s.height, 1, OpenImageIO::TypeDesc::FLOAT));
+            read_depth(static_cast<float *>(buffer->localpixels()));
+            return buffer;
+        }
+
+        /**
+         * Reads a depth texture as floats in [0, 1], rows bottom-up. Wrap with
+         * Eigen::Map<Eigen::Matrix<float, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>
+         * (rows = height) to process it as a matrix.
+         *
+         * @param stride Bytes between the first values of two rows, 0 if tightly packed.
+         */
+        void read_depth(float *depth, size_t stride = 0) {
             glBindTexture(target(), id());
 
-            GLint internalFormat;
-            glGetTexLevelParameteriv(target(), 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            GLint depth_bits;
+            glGetTexLevelParameteriv(target(), 0, GL_TEXTURE_DEPTH_SIZE, &depth_bits);
+            assertNoGLError("glGetTexLevelParameteriv");
 
-            if (internalFormat != GL_RGBA && internalFormat != GL_BGRA) {
-                throw TextureError("Internal format must be GL_RGBA or GL_BGRA to extract image.");
+            if (depth_bits == 0) {
+                throw TextureError("Texture has no depth component to read.");
             }
 
-            auto buffer = std::make_shared<OpenImageIO::ImageBuf>("texture", size());
+            const auto s = size();
 
-            glGetTexImage(target(), 0, GL_RGBA, GL_UNSIGNED_BYTE, buffer->localpixels());
+            glPixelStorei(GL_PACK_ALIGNMENT, 4);
+            glPixelStorei(GL_PACK_ROW_LENGTH, row_length(stride, sizeof(float), s.width));
+            glGetTexImage(target(), 0, GL_DEPTH_COMPONENT, GL_FLOAT, depth);
+            glPixelStorei(GL_PACK_ROW_LENGTH, 0);
             assertNoGLError("glGetTexImage");
+            GPGPU_TRACE_DOWNLOAD("Texture2D::read_depth", size_t(s.width) * s.height * sizeof(float));
+        }
 
+        std::shared_ptr <OpenImageIO::ImageBuf> image(Orientation orientation = BottomUp) {
+            auto buffer = std::make_shared<OpenImageIO::ImageBuf>("texture", size());
+            read(buffer->localpixels(), 0, orientation);
             return buffer;
         }
 
+        /**
+         * Reads into an existing image, which allows reusing it across frames.
+         */
+        void read(OpenImageIO::ImageBuf &image, Orientation orientation = BottomUp) {
+            const auto s = size();
+            const auto i = image.spec();
+
+            if (i.width != s.width || i.height != s.height || i.nchannels != s.nchannels ||
+                i.format != OpenImageIO::TypeDesc::UINT8) {
+                throw TextureError("Image needs to match the texture size and be RGBA with 8 bit per channel.");
+            }
+
+            read(local_pixels(image), 0, orientation);
+        }
+
+        /**
+         * Reads the texture as RGBA with 8 bit per channel.
+         *
+         * TopDown is flipped by the GPU while copying into a scratch
+         * renderbuffer, so the rows land in their final order without a
+         * second pass over the pixels on the CPU.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         */
+        void read(void *pixels, size_t stride = 0, Orientation orientation = BottomUp) {
+            glBindTexture(target(), id());
+            assert_readable();
+
+            const auto s = size();
+            PackState pack(4, row_length(stride, DEFAULT_TEXTURE_CHANNELS, s.width));
+
+            if (orientation == BottomUp) {
+                glGetTexImage(target(), 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                assertNoGLError("glGetTexImage");
+            } else {
+                GLint read_framebuffer, draw_framebuffer;
+                glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+                glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_framebuffer);
+
+                try {
+                    bind_flip_framebuffers(s.width, s.height);
+
+                    glBlitFramebuffer(0, 0, s.width, s.height, 0, s.height, s.width, 0,
+                                      GL_COLOR_BUFFER_BIT, GL_NEAREST);
+                    assertNoGLError("glBlitFramebuffer");
+
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, _flip_framebuffers[1]);
+                    glReadBuffer(GL_COLOR_ATTACHMENT0);
+                    glReadPixels(0, 0, s.width, s.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                    assertNoGLError("glReadPixels");
+                } catch (...) {
+                    // Don't leave the caller drawing into the scratch framebuffer.
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+                    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+                    throw;
+                }
+
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_framebuffer);
+            }
+
+            GPGPU_TRACE_DOWNLOAD("Texture2D::read", size_t(s.width) * s.height * DEFAULT_TEXTURE_CHANNELS);
+        }
+
+        /**
+         * Reads a region as RGBA with 8 bit per channel, rows in storage
+         * order (bottom-up). Only the region is transferred.
+         */
+        std::shared_ptr <OpenImageIO::ImageBuf> image(const Region &region) {
+            auto buffer = std::make_shared<OpenImageIO::ImageBuf>(
+                    "region", OpenImageIO::ImageSpec(region.width, region.height, DEFAULT_TEXTURE_CHANNELS));
+            read(region, buffer->localpixels());
+            return buffer;
+        }
+
+        /**
+         * Reads a region as RGBA with 8 bit per channel, rows in storage
+         * order (bottom-up). Uses glGetTextureSubImage with GL 4.5 /
+         * ARB_get_texture_sub_image, glReadPixels from a framebuffer otherwise.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         */
+        void read(const Region &region, void *pixels, size_t stride = 0) {
+            glBindTexture(target(), id());
+            assert_readable();
+            assert_region(region, size());
+
+            const size_t pixel = DEFAULT_TEXTURE_CHANNELS;
+            const size_t row_stride = stride != 0 ? stride : region.width * pixel;
+            const GLint length = row_length(stride, pixel, region.width);
+
+            PackState pack(1, length);
+
+            if (GLEW_VERSION_4_5 || GLEW_ARB_get_texture_sub_image) {
+                glGetTextureSubImage(id(), 0, region.x, region.y, 0, region.width, region.height, 1,
+                                     GL_RGBA, GL_UNSIGNED_BYTE,
+                                     row_stride * (region.height - 1) + region.width * pixel, pixels);
+                assertNoGLError("glGetTextureSubImage");
+            } else {
+                const GLint previous = bind_read_framebuffer();
+                glReadPixels(region.x, region.y, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+                assertNoGLError("glReadPixels");
+            }
+
+            GPGPU_TRACE_DOWNLOAD("Texture2D::read", region.texels() * pixel);
+        }
+
+        /**
+         * Uploads an image of the texture's size with 1 to 4 channels of
+         * 8/16 bit, half or float values. Rows are uploaded in storage order,
+         * so a read back BottomUp returns them in the image's orientation.
+         */
+        void set(const OpenImageIO::ImageBuf &image) {
+            glBindTexture(target(), id());
+
+            const auto s = size();
+            const auto &i = image.spec();
+
+            if (i.width != s.width || i.height != s.height) {
+                std::stringstream msg;
+                msg << "Image needs to have the same size as the texture (image=" << i.width << "x" << i.height <<
+                        ", texture=" << s.width << "x" << s.height << ").";
+                throw TextureError(msg.str());
+            }
+
+            const GLenum format = pixel_format(i.nchannels);
+            const GLenum type = pixel_type(i.format);
+            const void *pixels = local_pixels(image);
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glTexSubImage2D(target(), 0, 0, 0, s.width, s.height, format, type, pixels);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            assertNoGLError("glTexSubImage2D");
+            GPGPU_TRACE_UPLOAD("Texture2D::set", i.image_bytes());
+        }
+
+        /**
+         * Uploads an image into the region starting at (x, y), see set(const ImageBuf &).
+         */
+        void set(unsigned int x, unsigned int y, const OpenImageIO::ImageBuf &image) {
+            const auto &i = image.spec();
+            set(Region(x, y, i.width, i.height), local_pixels(image), pixel_format(i.nchannels),
+                pixel_type(i.format));
+        }
+
+        /**
+         * Uploads `pixels` in `format` and `type` into a region, rows in
+         * storage order (bottom-up). Only the region is transferred.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         */
+        void set(const Region &region, const void *pixels, GLenum format = GL_RGBA,
+                 GLenum type = GL_UNSIGNED_BYTE, size_t stride = 0) {
+            glBindTexture(target(), id());
+            assert_region(region, size());
+
+            const size_t pixel = pixel_size(format, type);
+            const GLint length = row_length(stride, pixel, region.width);
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, length);
+            glTexSubImage2D(target(), 0, region.x, region.y, region.width, region.height, format, type, pixels);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            assertNoGLError("glTexSubImage2D");
+            GPGPU_TRACE_UPLOAD("Texture2D::set", region.texels() * pixel);
+        }
+
         OpenImageIO::ImageSpec size() {
             GLint width;
             GLint height;
@@ -126,8 +624,78 @@ namespace gpgpu {
         virtual void clear() {
 
         };
+
+        void label(const std::string &label) override {
+            Texture::label(label);
+            _flip_memory.label(label);
+        }
+
+    protected:
+        /**
+         * Texture without storage, for subclasses that allocate their own.
+         */
+        Texture2D() : Texture(GL_TEXTURE_2D) {
+
+        }
+
+    private:
+        /*
+         * Texture attachment (read) and scratch renderbuffer (draw) for TopDown read backs.
+         */
+        GLuint _flip_framebuffers[2] = {0, 0};
+        GLuint _flip_renderbuffer = 0;
+        MemoryAllocation _flip_memory{MemoryTracker::RenderbufferMemory};
+
+        void bind_flip_framebuffers(int width, int height) {
+            if (_flip_framebuffers[0] == 0) {
+                _flip_memory.resize(size_t(width) * height * DEFAULT_TEXTURE_CHANNELS);
+
+                glGenFramebuffers(2, _flip_framebuffers);
+                glGenRenderbuffers(1, &_flip_renderbuffer);
+
+                glBindRenderbuffer(GL_RENDERBUFFER, _flip_renderbuffer);
+                glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+                assertNoGLError("glRenderbufferStorage");
+
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, _flip_framebuffers[0]);
+                glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, target(), id(), 0);
+                assertNoGLError("glFramebufferTexture2D");
+
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _flip_framebuffers[1]);
+                glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER,
+                                          _flip_renderbuffer);
+                assertNoGLError("glFramebufferRenderbuffer");
+            }
+
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, _flip_framebuffers[0]);
+            glBindFramebuffer(GL_DRAW_FRAMEBUFFER, _flip_framebuffers[1]);
+            assertNoGLError("glBindFramebuffer");
+        }
     };
 
+    /**
+     * Texture2D usable as Framebuffer depth attachment, GL_DEPTH_COMPONENT16/24/32F
+     * or GL_DEPTH24_STENCIL8/GL_DEPTH32F_STENCIL8 for depth-stencil.
+     */
+    inline std::shared_ptr<Texture2D> create_depth_texture(unsigned int width, unsigned int height,
+                                                           GLenum internalFormat = GL_DEPTH_COMPONENT32F) {
+        GLenum format = GL_DEPTH_COMPONENT;
+        GLenum type = GL_FLOAT;
+
+        if (internalFormat == GL_DEPTH24_STENCIL8) {
+            format = GL_DEPTH_STENCIL;
+            type = GL_UNSIGNED_INT_24_8;
+        } else if (internalFormat == GL_DEPTH32F_STENCIL8) {
+            format = GL_DEPTH_STENCIL;
+            type = GL_FLOAT_32_UNSIGNED_INT_24_8_REV;
+        }
+
+        auto texture = std::make_shared<Texture2D>(width, height, internalFormat, format, type);
+        texture->bind();
+        texture->set_filter(GL_NEAREST);
+        return texture;
+    }
+
     class TextureArray2D : public Texture {
     public:
         TextureArray2D(unsigned int width, unsigned int height, unsigned int layers,
@@ -136,6 +704,8 @@ namespace gpgpu {
                        GLenum type = DEFAULT_TEXTURE_TYPE)
                 : Texture(GL_TEXTURE_2D_ARRAY) {
 
+            _memory.resize(size_t(width) * height * layers * texel_size(internalFormat));
+
             glBindTexture(target(), id());
             assertNoGLError("glBindTexture");
 
@@ -143,52 +713,117 @@ namespace gpgpu {
             assertNoGLError("glTexImage3D");
         }
 
-
         std::shared_ptr<OpenImageIO::ImageBuf> image(unsigned int layer) {
+            return images(layer, 1).front();
+        }
+
+        /**
+         * Reads a region of one layer, see Texture2D::image(const Region &).
+         */
+        std::shared_ptr<OpenImageIO::ImageBuf> image(const Region &region, unsigned int layer) {
+            auto buffer = std::make_shared<OpenImageIO::ImageBuf>(
+                    "region", OpenImageIO::ImageSpec(region.width, region.height, DEFAULT_TEXTURE_CHANNELS));
+            read(region, layer, 1, buffer->localpixels());
+            return buffer;
+        }
+
+        /**
+         * Reads `count` layers starting at `first`, one image per layer.
+         * Every layer is read straight into its image.
+         */
+        std::vector<std::shared_ptr<OpenImageIO::ImageBuf>> images(unsigned int first, unsigned int count) {
             glBindTexture(target(), id());
+            const auto s = size();
+            assert_layers(first, count, s);
 
-            GLint internalFormat;
-            glGetTexLevelParameteriv(target(), 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat);
+            auto layer = s;
+            layer.depth = 1;
+            const Region region(0, 0, s.width, s.height);
 
-            if (internalFormat != GL_RGBA && internalFormat != GL_BGRA) {
-                throw TextureError("Internal format must be GL_RGBA or GL_BGRA to extract image.");
+            std::vector<std::shared_ptr<OpenImageIO::ImageBuf>> result;
+            result.reserve(count);
+
+            for (unsigned int i = 0; i < count; ++i) {
+                result.push_back(std::make_shared<OpenImageIO::ImageBuf>("texture", layer));
+                read(region, first + i, 1, result.back()->localpixels());
             }
 
-            auto s = size();
-            s.depth = 0;
-            auto buffer = std::make_shared<OpenImageIO::ImageBuf>("texture", s);
+            return result;
+        }
 
-            /*
-             * Dummy FB to bind the requested layer as attachment.
-             */
-            GLuint fb;
-            glGenFramebuffers(1, &fb);
-            glBindFramebuffer(GL_FRAMEBUFFER, fb);
-            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, id(), 0, layer);
-            assertNoGLError("glFramebufferTextureLayer");
+        /**
+         * Reads `count` layers starting at `first` as RGBA with 8 bit per
+         * channel into one tightly packed buffer, layer after layer.
+         */
+        void read(unsigned int first, unsigned int count, void *pixels) {
+            glBindTexture(target(), id());
+            const auto s = size();
+            read(Region(0, 0, s.width, s.height), first, count, pixels);
+        }
 
-            /*
-             * Read the attachment.
-             */
-            glReadBuffer(GL_COLOR_ATTACHMENT0);
-            glReadPixels(0, 0, s.width, s.height, GL_RGBA, GL_UNSIGNED_BYTE, buffer->localpixels());
-            assertNoGLError("glReadPixels");
+        /**
+         * Reads a region of `count` layers starting at `first` as RGBA with
+         * 8 bit per channel, rows in storage order (bottom-up).
+         *
+         * The whole array (or any range with GL 4.5 / ARB_get_texture_sub_image)
+         * is transferred at once, otherwise layer by layer through a
+         * framebuffer kept for the lifetime of the texture.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         * @param layer_stride Bytes between the first pixels of two layers, 0 if tightly packed.
+         */
+        void read(const Region &region, unsigned int first, unsigned int count, void *pixels,
+                  size_t stride = 0, size_t layer_stride = 0) {
+            glBindTexture(target(), id());
+            assert_readable();
 
-            glDeleteFramebuffers(1, &fb);
-            assertNoGLError("glDeleteFramebuffers");
+            const auto s = size();
+            assert_region(region, s);
+            assert_layers(first, count, s);
+
+            const size_t pixel = DEFAULT_TEXTURE_CHANNELS;
+            const size_t row_stride = stride != 0 ? stride : region.width * pixel;
+            const GLint length = row_length(stride, pixel, region.width);
+            const GLint rows = image_height(layer_stride, row_stride, region.height);
+            const size_t layer_size = row_stride * (rows != 0 ? rows : region.height);
+
+            PackState pack(1, length, rows);
+
+            const bool whole = region.width == static_cast<unsigned int>(s.width) &&
+                               region.height == static_cast<unsigned int>(s.height) &&
+                               first == 0 && count == static_cast<unsigned int>(s.depth);
+
+            if (whole) {
+                glGetTexImage(target(), 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                assertNoGLError("glGetTexImage");
+            } else if (GLEW_VERSION_4_5 || GLEW_ARB_get_texture_sub_image) {
+                glGetTextureSubImage(id(), 0, region.x, region.y, first, region.width, region.height, count,
+                                     GL_RGBA, GL_UNSIGNED_BYTE,
+                                     layer_size * (count - 1) + row_stride * (region.height - 1) +
+                                     region.width * pixel, pixels);
+                assertNoGLError("glGetTextureSubImage");
+            } else {
+                // glReadPixels ignores GL_PACK_IMAGE_HEIGHT, layers are advanced here.
+                GLint previous = 0;
+                auto out = static_cast<unsigned char *>(pixels);
+
+                for (unsigned int layer = first; layer < first + count; ++layer) {
+                    previous = bind_read_framebuffer(layer);
+                    glReadPixels(region.x, region.y, region.width, region.height, GL_RGBA, GL_UNSIGNED_BYTE, out);
+                    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous);
+                    assertNoGLError("glReadPixels");
+
+                    out += layer_size;
+                }
+            }
 
-            return buffer;
+            GPGPU_TRACE_DOWNLOAD("TextureArray2D::read", region.texels() * pixel * count);
         }
 
         void set(unsigned int layer, const OpenImageIO::ImageBuf &image) {
+            glBindTexture(target(), id());
             const auto s = size();
-            const auto i = image.spec();
-
-            if (layer >= s.depth) {
-                std::stringstream msg;
-                msg << "Layer (" << layer << ") exceeds layer count (" << s.depth << ").";
-                throw TextureError(msg.str());
-            }
+            const auto &i = image.spec();
 
             if (i.width != s.width || i.height != s.height) {
                 std::stringstream msg;
@@ -197,13 +832,51 @@ namespace gpgpu {
                 throw TextureError(msg.str());
             }
 
-            // Alpha channel?
-            GLenum type = i.nchannels == 4 ? GL_RGBA : GL_RGB;
+            set(0, 0, layer, image);
+        }
+
+        /**
+         * Uploads an image with 1 to 4 channels of 8/16 bit, half or float
+         * values into the region of `layer` starting at (x, y).
+         */
+        void set(unsigned int x, unsigned int y, unsigned int layer, const OpenImageIO::ImageBuf &image) {
+            const auto &i = image.spec();
+            set(Region(x, y, i.width, i.height), layer, 1, local_pixels(image), pixel_format(i.nchannels),
+                pixel_type(i.format));
+        }
 
+        /**
+         * Uploads `pixels` in `format` and `type` into a region of `count`
+         * layers starting at `first`, rows in storage order (bottom-up).
+         * Only the region is transferred.
+         *
+         * @param stride Bytes between the first pixels of two rows, 0 if tightly packed.
+         * @param layer_stride Bytes between the first pixels of two layers, 0 if tightly packed.
+         */
+        void set(const Region &region, unsigned int first, unsigned int count, const void *pixels,
+                 GLenum format = GL_RGBA, GLenum type = GL_UNSIGNED_BYTE, size_t stride = 0,
+                 size_t layer_stride = 0) {
             glBindTexture(target(), id());
-            glTexSubImage3D(target(), 0, 0, 0, layer, s.width, s.height, 1, type, GL_UNSIGNED_BYTE,
-                            image.localpixels());
+
+            const auto s = size();
+            assert_region(region, s);
+            assert_layers(first, count, s);
+
+            const size_t pixel = pixel_size(format, type);
+            const size_t row_stride = stride != 0 ? stride : region.width * pixel;
+            const GLint length = row_length(stride, pixel, region.width);
+            const GLint rows = image_height(layer_stride, row_stride, region.height);
+
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, length);
+            glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, rows);
+            glTexSubImage3D(target(), 0, region.x, region.y, first, region.width, region.height, count,
+                            format, type, pixels);
+            glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
             assertNoGLError("glTexSubImage3D");
+            GPGPU_TRACE_UPLOAD("TextureArray2D::set", region.texels() * pixel * count);
         }
 
         OpenImageIO::ImageSpec size() {
@@ -220,6 +893,25 @@ namespace gpgpu {
             spec.depth = depth;
             return spec;
         }
+
+    protected:
+        /**
+         * Texture array without storage, for subclasses that allocate their own.
+         */
+        TextureArray2D() : Texture(GL_TEXTURE_2D_ARRAY) {
+
+        }
+
+    private:
+        static void assert_layers(unsigned int first, unsigned int count, const OpenImageIO::ImageSpec &s) {
+            const auto layers = static_cast<unsigned int>(s.depth);
+
+            if (count == 0 || first >= layers || count > layers - first) {
+                std::stringstream msg;
+                msg << count << " layers from " << first << " exceed layer count (" << s.depth << ").";
+                throw TextureError(msg.str());
+            }
+        }
     };
 }
 
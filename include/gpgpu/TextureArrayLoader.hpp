@@ -0,0 +1,246 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_TEXTUREARRAYLOADER_HPP
+#define GPGPU_OPENGL_TEXTUREARRAYLOADER_HPP
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <string>
+#include <vector>
+
+#include <OpenImageIO/imagebuf.h>
+
+#include "OpenGLObject.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Fills TextureArray2D layers from image files.
+     *
+     * Files are decoded by OpenImageIO on a thread pool straight into a
+     * mapped pixel unpack buffer and converted to RGBA with 8 bit per
+     * channel, OpenGL converts to the internal format of the array. Every
+     * `layers_per_upload` layers are transferred with one glTexSubImage3D,
+     * alternating between two staging buffers so the next batch decodes
+     * while the previous one is still being transferred.
+     *
+     * Layers keep the row order of the files, the same as TextureArray2D::set().
+     */
+    class TextureArrayLoader : public OpenGLObject {
+    public:
+        explicit TextureArrayLoader(unsigned int threads = 0, unsigned int layers_per_upload = 16);
+
+        ~TextureArrayLoader();
+
+        TextureArrayLoader(const TextureArrayLoader &) = delete;
+
+        TextureArrayLoader &operator=(const TextureArrayLoader &) = delete;
+
+        /**
+         * Loads files[i] into layer first_layer + i.
+         *
+         * @throws TextureError if a file can't be read or doesn't match the layer size.
+         */
+        void load(TextureArray2D &array, const std::vector<std::string> &files, unsigned int first_layer = 0);
+
+        /**
+         * Decodes `filename` into `pixels` as tightly packed RGBA with 8 bit per channel.
+         */
+        static void decode(const std::string &filename, int width, int height, unsigned char *pixels);
+
+    protected:
+        ThreadPool _pool;
+        unsigned int _layers_per_upload;
+
+        GLuint _staging[2] = {0, 0};
+        size_t _staging_size = 0;
+        MemoryAllocation _staging_memory{MemoryTracker::BufferMemory};
+
+        void reserve_staging(size_t size);
+    };
+
+
+    /*
+     * Definition
+     */
+    inline TextureArrayLoader::TextureArrayLoader(unsigned int threads, unsigned int layers_per_upload)
+            : _pool(threads), _layers_per_upload(std::max(layers_per_upload, 1u)) {
+
+        glGenBuffers(2, _staging);
+        assertNoGLError("glGenBuffers");
+    }
+
+    inline TextureArrayLoader::~TextureArrayLoader() {
+        glDeleteBuffers(2, _staging);
+    }
+
+    inline void TextureArrayLoader::reserve_staging(size_t size) {
+        if (size <= _staging_size) {
+            return;
+        }
+
+        _staging_memory.resize(2 * size);
+
+        for (auto buffer : _staging) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+            assertNoGLError("glBufferData");
+        }
+
+        _staging_size = size;
+    }
+
+    inline void TextureArrayLoader::load(TextureArray2D &array, const std::vector<std::string> &files,
+                                         unsigned int first_layer) {
+        if (files.empty()) {
+            return;
+        }
+
+        const auto s = array.size();
+
+        if (first_layer + files.size() > static_cast<size_t>(s.depth)) {
+            std::stringstream msg;
+            msg << "Layers [" << first_layer << ", " << first_layer + files.size() << ") exceed layer count (" <<
+                    s.depth << ").";
+            throw TextureError(msg.str());
+        }
+
+        const size_t layer_size = size_t(s.width) * s.height * DEFAULT_TEXTURE_CHANNELS;
+        reserve_staging(layer_size * std::min<size_t>(_layers_per_upload, files.size()));
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+        array.bind();
+
+        // Unbinds the staging buffer on every exit, client pointer uploads would read from it otherwise.
+        struct UnpackBufferBinding {
+            ~UnpackBufferBinding() {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+            }
+        } binding;
+
+        std::exception_ptr error;
+
+        for (size_t batch = 0, index = 0; batch < files.size() && !error; ++index) {
+            const size_t n = std::min<size_t>(_layers_per_upload, files.size() - batch);
+
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging[index % 2]);
+            auto staging = static_cast<unsigned char *>(glMapBufferRange(
+                    GL_PIXEL_UNPACK_BUFFER, 0, layer_size * n, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+            assertNoGLError("glMapBufferRange");
+
+            std::vector<std::future<void>> decoded;
+            decoded.reserve(n);
+
+            for (size_t i = 0; i < n; ++i) {
+                const std::string &filename = files[batch + i];
+                auto pixels = staging + i * layer_size;
+
+                decoded.push_back(_pool.async([&filename, &s, pixels]() {
+                    decode(filename, s.width, s.height, pixels);
+                }));
+            }
+
+            // Every worker has to finish writing before the buffer can be unmapped.
+            for (auto &f : decoded) {
+                try {
+                    f.get();
+                } catch (...) {
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            }
+
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            assertNoGLError("glUnmapBuffer");
+
+            if (!error) {
+                glTexSubImage3D(array.target(), 0, 0, 0, first_layer + batch, s.width, s.height, n,
+                                GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                assertNoGLError("glTexSubImage3D");
+                GPGPU_TRACE_UPLOAD("TextureArrayLoader::load", layer_size * n);
+            }
+
+            batch += n;
+        }
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    inline void TextureArrayLoader::decode(const std::string &filename, int width, int height,
+                                           unsigned char *pixels) {
+        OpenImageIO::ImageBuf image(filename);
+
+        if (!image.read(0, 0, true, OpenImageIO::TypeDesc::UINT8)) {
+            throw TextureError("Failed to read “" + filename + "”: " + image.geterror());
+        }
+
+        const auto &i = image.spec();
+
+        if (i.width != width || i.height != height) {
+            std::stringstream msg;
+            msg << "Image “" << filename << "” needs to have the same size as an array layer (image=" <<
+                    i.width << "x" << i.height << ", array=" << width << "x" << height << ").";
+            throw TextureError(msg.str());
+        }
+
+        const size_t count = size_t(width) * height;
+        auto in = static_cast<const unsigned char *>(image.localpixels());
+
+        if (i.nchannels == DEFAULT_TEXTURE_CHANNELS) {
+            std::memcpy(pixels, in, count * DEFAULT_TEXTURE_CHANNELS);
+            return;
+        }
+
+        /*
+         * Expand to RGBA: gray is replicated, missing alpha is opaque
+         * and channels beyond the fourth are dropped.
+         */
+        const int c = i.nchannels;
+
+        for (size_t p = 0; p < count; ++p, in += c, pixels += DEFAULT_TEXTURE_CHANNELS) {
+            if (c < 3) {
+                pixels[0] = pixels[1] = pixels[2] = in[0];
+                pixels[3] = c == 2 ? in[1] : 255;
+            } else {
+                pixels[0] = in[0];
+                pixels[1] = in[1];
+                pixels[2] = in[2];
+                pixels[3] = c > 3 ? in[3] : 255;
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_OPENGL_TEXTUREARRAYLOADER_HPP */
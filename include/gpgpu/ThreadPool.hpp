@@ -0,0 +1,201 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_THREADPOOL_HPP
+#define GPGPU_THREADPOOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace gpgpu {
+    /*
+     * Declaration
+     */
+
+    /**
+     * Fixed set of worker threads consuming a bounded task queue.
+     *
+     * submit() blocks while the queue is full, so a producer (usually the
+     * thread owning the OpenGL context) can never run ahead of the workers
+     * by more than `capacity` tasks. Tasks must not issue OpenGL calls and
+     * must not throw, use async() to receive exceptions through a future.
+     */
+    class ThreadPool {
+    public:
+        /**
+         * @param threads Number of workers, 0 selects all but one hardware thread.
+         * @param capacity Maximum number of queued tasks, 0 selects twice the worker count.
+         */
+        explicit ThreadPool(unsigned int threads = 0, size_t capacity = 0);
+
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool &) = delete;
+
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        void submit(std::function<void()> task);
+
+        bool try_submit(std::function<void()> task);
+
+        template<typename F>
+        std::future<typename std::result_of<F()>::type> async(F f) {
+            typedef typename std::result_of<F()>::type Result;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(f);
+            auto future = task->get_future();
+            submit([task]() { (*task)(); });
+            return future;
+        }
+
+        /**
+         * Blocks until the queue is empty and no task is running.
+         */
+        void wait();
+
+        size_t size() const {
+            return _workers.size();
+        }
+
+        size_t capacity() const {
+            return _capacity;
+        }
+
+        static unsigned int default_thread_count();
+
+    protected:
+        std::vector<std::thread> _workers;
+        std::deque<std::function<void()>> _tasks;
+        size_t _capacity;
+        size_t _running = 0;
+        bool _stop = false;
+
+        std::mutex _mutex;
+        std::condition_variable _task_available;
+        std::condition_variable _space_available;
+        std::condition_variable _idle;
+
+        void work();
+    };
+
+
+    /*
+     * Definition
+     */
+    inline ThreadPool::ThreadPool(unsigned int threads, size_t capacity) {
+        if (threads == 0) {
+            threads = default_thread_count();
+        }
+
+        _capacity = capacity == 0 ? 2 * threads : capacity;
+
+        for (unsigned int i = 0; i < threads; ++i) {
+            _workers.emplace_back(&ThreadPool::work, this);
+        }
+    }
+
+    inline ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+
+        _task_available.notify_all();
+
+        for (auto &worker : _workers) {
+            worker.join();
+        }
+    }
+
+    inline unsigned int ThreadPool::default_thread_count() {
+        auto n = std::thread::hardware_concurrency();
+        return n > 1 ? n - 1 : 1;
+    }
+
+    inline void ThreadPool::submit(std::function<void()> task) {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _space_available.wait(lock, [this]() { return _tasks.size() < _capacity; });
+        _tasks.push_back(std::move(task));
+        lock.unlock();
+
+        _task_available.notify_one();
+    }
+
+    inline bool ThreadPool::try_submit(std::function<void()> task) {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_tasks.size() >= _capacity) {
+            return false;
+        }
+
+        _tasks.push_back(std::move(task));
+        lock.unlock();
+
+        _task_available.notify_one();
+        return true;
+    }
+
+    inline void ThreadPool::wait() {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _idle.wait(lock, [this]() { return _tasks.empty() && _running == 0; });
+    }
+
+    inline void ThreadPool::work() {
+        for (;;) {
+            std::function<void()> task;
+
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _task_available.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+
+                // Drain the queue before stopping, pending work is never dropped.
+                if (_tasks.empty()) {
+                    return;
+                }
+
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+                ++_running;
+            }
+
+            _space_available.notify_one();
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                --_running;
+
+                if (_tasks.empty() && _running == 0) {
+                    _idle.notify_all();
+                }
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_THREADPOOL_HPP */
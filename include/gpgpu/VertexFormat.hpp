@@ -0,0 +1,182 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_OPENGL_VERTEXFORMAT_HPP
+#define GPGPU_OPENGL_VERTEXFORMAT_HPP
+
+#include <array>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+#include <Eigen/Dense>
+
+#include "OpenGLObject.hpp"
+#include "Buffer.hpp"
+
+namespace gpgpu {
+    /**
+     * OpenGL type and component count of a vertex member: scalars,
+     * C arrays, std::array and fixed size Eigen vectors of 1 to 4 components.
+     */
+    template<typename T>
+    struct VertexComponent {
+        static constexpr Buffer::ValueType type = BufferValueType<T>::value;
+        static constexpr GLint size = 1;
+    };
+
+    template<typename T, size_t N>
+    struct VertexComponent<T[N]> {
+        static_assert(N >= 1 && N <= 4, "Vertex attributes have 1 to 4 components.");
+        static constexpr Buffer::ValueType type = BufferValueType<T>::value;
+        static constexpr GLint size = N;
+    };
+
+    template<typename T, size_t N>
+    struct VertexComponent<std::array<T, N>> : VertexComponent<T[N]> {
+
+    };
+
+    template<typename T, int _Rows, int _Cols, int _Options, int _MaxRows, int _MaxCols>
+    struct VertexComponent<Eigen::Matrix<T, _Rows, _Cols, _Options, _MaxRows, _MaxCols>> {
+        static_assert(_Rows >= 1 && _Rows <= 4 && _Cols == 1,
+                      "Vertex attributes need to be fixed size column vectors with 1 to 4 components.");
+        static constexpr Buffer::ValueType type = BufferValueType<T>::value;
+        static constexpr GLint size = _Rows;
+    };
+
+    /**
+     * One member of an interleaved vertex struct, declared through
+     * GPGPU_VERTEX_ATTRIBUTE which takes the offset with offsetof.
+     *
+     * @tparam Normalized Map integer types to [0, 1] (unsigned) or [-1, 1] (signed).
+     */
+    template<typename Vertex, typename T, size_t Offset, bool Normalized = false>
+    struct VertexAttribute {
+        static_assert(std::is_standard_layout<Vertex>::value,
+                      "Interleaved vertices need to be standard layout types.");
+        static_assert(Offset + sizeof(T) <= sizeof(Vertex), "Vertex attribute lies outside the vertex.");
+
+        static constexpr Buffer::ValueType type = VertexComponent<T>::type;
+        static constexpr GLint size = VertexComponent<T>::size;
+        static constexpr GLboolean normalized = Normalized ? GL_TRUE : GL_FALSE;
+        static constexpr size_t offset = Offset;
+
+        static void bind(GLint location) {
+            if (location < 0) {
+                return;
+            }
+
+            glVertexAttribPointer(location, size, type, normalized, sizeof(Vertex),
+                                  reinterpret_cast<const GLvoid *>(offset));
+        }
+    };
+
+    /**
+     * Compile-time layout of an interleaved vertex struct, e.g.
+     *
+     *   struct Vertex {
+     *       Eigen::Vector3f position;
+     *       Eigen::Vector2f uv;
+     *   };
+     *
+     *   typedef gpgpu::VertexFormat<Vertex,
+     *           GPGPU_VERTEX_ATTRIBUTE(Vertex, position),
+     *           GPGPU_VERTEX_ATTRIBUTE(Vertex, uv)> Format;
+     */
+    template<typename Vertex, typename... Attributes>
+    struct VertexFormat;
+
+    template<typename Vertex>
+    struct VertexFormat<Vertex> {
+        typedef Vertex Type;
+        static constexpr size_t attributes = 0;
+        static constexpr GLsizei stride = sizeof(Vertex);
+
+        static void bind(const GLint *) {
+
+        }
+    };
+
+    template<typename Vertex, typename First, typename... Rest>
+    struct VertexFormat<Vertex, First, Rest...> {
+        typedef Vertex Type;
+        static constexpr size_t attributes = 1 + sizeof...(Rest);
+        static constexpr GLsizei stride = sizeof(Vertex);
+
+        /**
+         * Sets up every attribute at its location, in declaration order.
+         * Negative locations are skipped.
+         */
+        static void bind(const GLint *locations) {
+            First::bind(locations[0]);
+            VertexFormat<Vertex, Rest...>::bind(locations + 1);
+        }
+    };
+
+    /**
+     * Interleaved vertex buffer, one struct per vertex. Bound through
+     * Program::attributes() with one call to glVertexAttribPointer per
+     * attribute, all types, strides and offsets are known at compile time.
+     */
+    template<typename Format>
+    class VertexBuffer : public Buffer {
+    public:
+        typedef typename Format::Type Vertex;
+
+        VertexBuffer() : Buffer(Buffer::Array) {
+
+        }
+
+        void data(size_t vertices, const Vertex *ptr) {
+            _memory.resize(vertices * sizeof(Vertex));
+
+            _elements = vertices;
+            _dimension = 1;
+            _valueType = Buffer::UnsignedByte;
+
+            Buffer::data(bytes(), ptr);
+        }
+
+        void data(const std::vector<Vertex> &vertices) {
+            data(vertices.size(), vertices.data());
+        }
+
+        size_t bytes() const override {
+            return _elements * sizeof(Vertex);
+        }
+
+        void bind(const GLint *locations) const {
+            glBindBuffer(_bufferType, _id);
+            Format::bind(locations);
+            assertNoGLError("glVertexAttribPointer");
+        }
+    };
+}
+
+#define GPGPU_VERTEX_ATTRIBUTE(Vertex, member) \
+    ::gpgpu::VertexAttribute<Vertex, decltype(Vertex::member), offsetof(Vertex, member)>
+
+#define GPGPU_NORMALIZED_VERTEX_ATTRIBUTE(Vertex, member) \
+    ::gpgpu::VertexAttribute<Vertex, decltype(Vertex::member), offsetof(Vertex, member), true>
+
+#endif /* GPGPU_OPENGL_VERTEXFORMAT_HPP */
@@ -0,0 +1,139 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_DAEMON_CLIENT_HPP
+#define GPGPU_DAEMON_CLIENT_HPP
+
+#include <algorithm>
+#include <memory>
+#include <string>
+
+#include <OpenImageIO/imagebuf.h>
+
+#include "Protocol.hpp"
+
+namespace gpgpu {
+    namespace daemon {
+        /*
+         * Declaration
+         */
+
+        /**
+         * Connection to a RenderServer, needs no OpenGL context. Jobs can be
+         * pipelined with send() and receive(), results arrive in order.
+         * Not thread safe, use one client per thread.
+         */
+        class RenderClient {
+        public:
+            explicit RenderClient(const std::string &path = DEFAULT_SOCKET_PATH);
+
+            ~RenderClient() {
+                ::close(_fd);
+            }
+
+            RenderClient(const RenderClient &) = delete;
+
+            RenderClient &operator=(const RenderClient &) = delete;
+
+            void send(const RenderJob &job);
+
+            /**
+             * Blocks for the next result, job errors are reported in it.
+             */
+            RenderResult receive();
+
+            /**
+             * Sends a job and waits for its result.
+             *
+             * @throws DaemonError if the job failed.
+             */
+            RenderResult render(const RenderJob &job);
+
+            /**
+             * Result as image, 8 bit or float RGBA.
+             */
+            static std::shared_ptr<OpenImageIO::ImageBuf> image(const RenderResult &result);
+
+        protected:
+            int _fd;
+        };
+
+
+        /*
+         * Definition
+         */
+        inline RenderClient::RenderClient(const std::string &path) {
+            const auto address = socket_address(path);
+
+            _fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (_fd < 0) {
+                throw DaemonError(std::string("Failed to create socket: ") + std::strerror(errno));
+            }
+
+            if (::connect(_fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+                const std::string error = std::strerror(errno);
+                ::close(_fd);
+                throw DaemonError("Failed to connect to “" + path + "”: " + error);
+            }
+        }
+
+        inline void RenderClient::send(const RenderJob &job) {
+            send_frame(_fd, encode(job));
+        }
+
+        inline RenderResult RenderClient::receive() {
+            const auto frame = receive_frame(_fd);
+            MessageReader reader(frame.data() + sizeof(uint32_t), frame.size() - sizeof(uint32_t));
+
+            RenderResult result;
+            decode(reader, result);
+            return result;
+        }
+
+        inline RenderResult RenderClient::render(const RenderJob &job) {
+            send(job);
+            auto result = receive();
+
+            if (!result.error.empty()) {
+                throw DaemonError(result.error);
+            }
+
+            return result;
+        }
+
+        inline std::shared_ptr<OpenImageIO::ImageBuf> RenderClient::image(const RenderResult &result) {
+            const OpenImageIO::ImageSpec spec(result.width, result.height, 4,
+                                              result.format == RGBA32F ? OpenImageIO::TypeDesc::FLOAT
+                                                                       : OpenImageIO::TypeDesc::UINT8);
+            auto image = std::make_shared<OpenImageIO::ImageBuf>("daemon", spec);
+
+            if (result.pixels.size() != spec.image_bytes()) {
+                throw DaemonError("Result size doesn't match its pixel data.");
+            }
+
+            std::copy(result.pixels.begin(), result.pixels.end(), static_cast<unsigned char *>(image->localpixels()));
+            return image;
+        }
+    }
+}
+
+#endif /* GPGPU_DAEMON_CLIENT_HPP */
@@ -0,0 +1,428 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_DAEMON_PROTOCOL_HPP
+#define GPGPU_DAEMON_PROTOCOL_HPP
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace gpgpu {
+    namespace daemon {
+        /*
+         * Declaration
+         *
+         * Messages between render daemon and clients are frames of a 32 bit
+         * payload length followed by the payload: magic, message type and
+         * the message's fields. Values are in host byte order, both ends
+         * run on the same machine.
+         */
+        class DaemonError : public std::runtime_error {
+        public:
+            using std::runtime_error::runtime_error;
+        };
+
+        static constexpr uint32_t PROTOCOL_MAGIC = 0x31445047; // "GPD1"
+        static constexpr uint32_t MAX_FRAME_SIZE = 256u << 20;
+        static constexpr const char *DEFAULT_SOCKET_PATH = "/tmp/gpgpu.sock";
+
+        enum MessageType : uint8_t {
+            RenderMessage = 1,
+            ResultMessage = 2
+        };
+
+        enum PixelFormat : uint8_t {
+            RGBA8 = 0,
+            RGBA32F = 1
+        };
+
+        /**
+         * Float uniform of `rows` x `cols` (column-major) times `count`
+         * array elements, or an int (rows or cols 1: ivec2-4) uniform if
+         * `integer` is set.
+         */
+        struct JobUniform {
+            std::string name;
+            uint32_t rows = 1;
+            uint32_t cols = 1;
+            uint32_t count = 1;
+            bool integer = false;
+            std::vector<float> values;
+        };
+
+        /**
+         * Draws `vertices` (bound to `attribute`, indexed if `indices` is
+         * not empty) into a width x height target. Without vertices a
+         * viewport filling triangle is drawn, which turns the fragment
+         * shader into a compute kernel over the output's pixels.
+         */
+        struct RenderJob {
+            std::string vertex_shader;
+            std::string fragment_shader;
+
+            std::string attribute = "vertex";
+            uint32_t dimension = 3;
+            uint32_t mode = 0x0004; // GL_TRIANGLES, GL_POINTS to GL_TRIANGLE_FAN
+            std::vector<float> vertices;
+            std::vector<uint32_t> indices;
+
+            std::vector<JobUniform> uniforms;
+
+            uint32_t width = 0;
+            uint32_t height = 0;
+            PixelFormat format = RGBA8;
+            bool depth_test = false;
+            bool top_down = true;
+        };
+
+        struct RenderResult {
+            /**
+             * Empty if the job succeeded.
+             */
+            std::string error;
+
+            uint32_t width = 0;
+            uint32_t height = 0;
+            PixelFormat format = RGBA8;
+            std::vector<unsigned char> pixels;
+
+            /**
+             * Time the daemon spent on the job.
+             */
+            double seconds = 0;
+        };
+
+        class MessageWriter {
+        public:
+            explicit MessageWriter(MessageType type);
+
+            template<typename T>
+            void value(T v) {
+                const auto p = reinterpret_cast<const unsigned char *>(&v);
+                _data.insert(_data.end(), p, p + sizeof(T));
+            }
+
+            void string(const std::string &s);
+
+            template<typename T>
+            void array(const std::vector<T> &values) {
+                value(static_cast<uint32_t>(values.size()));
+                const auto p = reinterpret_cast<const unsigned char *>(values.data());
+                _data.insert(_data.end(), p, p + values.size() * sizeof(T));
+            }
+
+            /**
+             * Length prefixed frame, the writer is empty afterwards.
+             */
+            std::vector<unsigned char> frame();
+
+        protected:
+            std::vector<unsigned char> _data;
+        };
+
+        class MessageReader {
+        public:
+            /**
+             * Reads the payload of a frame, `data` points behind its length.
+             */
+            MessageReader(const unsigned char *data, size_t size);
+
+            MessageType type() const {
+                return _type;
+            }
+
+            template<typename T>
+            T value() {
+                T v;
+                std::memcpy(&v, take(sizeof(T)), sizeof(T));
+                return v;
+            }
+
+            std::string string();
+
+            template<typename T>
+            std::vector<T> array() {
+                const auto n = value<uint32_t>();
+
+                if (n > (_end - _position) / sizeof(T)) {
+                    throw DaemonError("Truncated message.");
+                }
+
+                std::vector<T> values(n);
+                std::memcpy(values.data(), take(n * sizeof(T)), n * sizeof(T));
+                return values;
+            }
+
+        protected:
+            const unsigned char *_position;
+            const unsigned char *_end;
+            MessageType _type;
+
+            const unsigned char *take(size_t size);
+        };
+
+        std::vector<unsigned char> encode(const RenderJob &job);
+
+        std::vector<unsigned char> encode(const RenderResult &result);
+
+        void decode(MessageReader &reader, RenderJob &job);
+
+        void decode(MessageReader &reader, RenderResult &result);
+
+        /**
+         * Size of the frame at the start of `data` if it's complete, 0 otherwise.
+         */
+        size_t complete_frame(const unsigned char *data, size_t size);
+
+        sockaddr_un socket_address(const std::string &path);
+
+        /**
+         * Blocking I/O of whole frames, for clients.
+         */
+        void send_frame(int fd, const std::vector<unsigned char> &frame);
+
+        std::vector<unsigned char> receive_frame(int fd);
+
+
+        /*
+         * Definition
+         */
+        inline MessageWriter::MessageWriter(MessageType type) : _data(sizeof(uint32_t)) {
+            value(PROTOCOL_MAGIC);
+            value(static_cast<uint8_t>(type));
+        }
+
+        inline void MessageWriter::string(const std::string &s) {
+            value(static_cast<uint32_t>(s.size()));
+            _data.insert(_data.end(), s.begin(), s.end());
+        }
+
+        inline std::vector<unsigned char> MessageWriter::frame() {
+            const auto size = static_cast<uint32_t>(_data.size() - sizeof(uint32_t));
+            std::memcpy(_data.data(), &size, sizeof(size));
+
+            std::vector<unsigned char> frame;
+            frame.swap(_data);
+            return frame;
+        }
+
+        inline MessageReader::MessageReader(const unsigned char *data, size_t size)
+                : _position(data), _end(data + size) {
+            if (value<uint32_t>() != PROTOCOL_MAGIC) {
+                throw DaemonError("Unknown protocol.");
+            }
+
+            _type = static_cast<MessageType>(value<uint8_t>());
+        }
+
+        inline const unsigned char *MessageReader::take(size_t size) {
+            if (size > static_cast<size_t>(_end - _position)) {
+                throw DaemonError("Truncated message.");
+            }
+
+            auto p = _position;
+            _position += size;
+            return p;
+        }
+
+        inline std::string MessageReader::string() {
+            const auto n = value<uint32_t>();
+            auto p = reinterpret_cast<const char *>(take(n));
+            return std::string(p, n);
+        }
+
+        inline std::vector<unsigned char> encode(const RenderJob &job) {
+            MessageWriter w(RenderMessage);
+            w.string(job.vertex_shader);
+            w.string(job.fragment_shader);
+            w.string(job.attribute);
+            w.value(job.dimension);
+            w.value(job.mode);
+            w.array(job.vertices);
+            w.array(job.indices);
+
+            w.value(static_cast<uint32_t>(job.uniforms.size()));
+            for (const auto &u : job.uniforms) {
+                w.string(u.name);
+                w.value(u.rows);
+                w.value(u.cols);
+                w.value(u.count);
+                w.value(static_cast<uint8_t>(u.integer));
+                w.array(u.values);
+            }
+
+            w.value(job.width);
+            w.value(job.height);
+            w.value(static_cast<uint8_t>(job.format));
+            w.value(static_cast<uint8_t>(job.depth_test));
+            w.value(static_cast<uint8_t>(job.top_down));
+            return w.frame();
+        }
+
+        inline void decode(MessageReader &r, RenderJob &job) {
+            if (r.type() != RenderMessage) {
+                throw DaemonError("Expected a render job.");
+            }
+
+            job.vertex_shader = r.string();
+            job.fragment_shader = r.string();
+            job.attribute = r.string();
+            job.dimension = r.value<uint32_t>();
+            job.mode = r.value<uint32_t>();
+            job.vertices = r.array<float>();
+            job.indices = r.array<uint32_t>();
+
+            const auto uniforms = r.value<uint32_t>();
+            job.uniforms.clear();
+
+            for (uint32_t i = 0; i < uniforms; ++i) {
+                JobUniform u;
+                u.name = r.string();
+                u.rows = r.value<uint32_t>();
+                u.cols = r.value<uint32_t>();
+                u.count = r.value<uint32_t>();
+                u.integer = r.value<uint8_t>() != 0;
+                u.values = r.array<float>();
+                job.uniforms.push_back(std::move(u));
+            }
+
+            job.width = r.value<uint32_t>();
+            job.height = r.value<uint32_t>();
+            job.format = static_cast<PixelFormat>(r.value<uint8_t>());
+            job.depth_test = r.value<uint8_t>() != 0;
+            job.top_down = r.value<uint8_t>() != 0;
+        }
+
+        inline std::vector<unsigned char> encode(const RenderResult &result) {
+            MessageWriter w(ResultMessage);
+            w.string(result.error);
+            w.value(result.width);
+            w.value(result.height);
+            w.value(static_cast<uint8_t>(result.format));
+            w.value(result.seconds);
+            w.array(result.pixels);
+            return w.frame();
+        }
+
+        inline void decode(MessageReader &r, RenderResult &result) {
+            if (r.type() != ResultMessage) {
+                throw DaemonError("Expected a render result.");
+            }
+
+            result.error = r.string();
+            result.width = r.value<uint32_t>();
+            result.height = r.value<uint32_t>();
+            result.format = static_cast<PixelFormat>(r.value<uint8_t>());
+            result.seconds = r.value<double>();
+            result.pixels = r.array<unsigned char>();
+        }
+
+        inline size_t complete_frame(const unsigned char *data, size_t size) {
+            if (size < sizeof(uint32_t)) {
+                return 0;
+            }
+
+            uint32_t length;
+            std::memcpy(&length, data, sizeof(length));
+
+            if (length > MAX_FRAME_SIZE) {
+                throw DaemonError("Frame exceeds the maximum size.");
+            }
+
+            return size - sizeof(length) >= length ? sizeof(length) + length : 0;
+        }
+
+        inline sockaddr_un socket_address(const std::string &path) {
+            sockaddr_un address;
+            std::memset(&address, 0, sizeof(address));
+            address.sun_family = AF_UNIX;
+
+            if (path.size() >= sizeof(address.sun_path)) {
+                throw DaemonError("Socket path “" + path + "” is too long.");
+            }
+
+            std::strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+            return address;
+        }
+
+        inline void send_frame(int fd, const std::vector<unsigned char> &frame) {
+            size_t sent = 0;
+
+            while (sent < frame.size()) {
+                const auto n = ::send(fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    throw DaemonError(std::string("Failed to send: ") + std::strerror(errno));
+                }
+
+                sent += n;
+            }
+        }
+
+        inline std::vector<unsigned char> receive_frame(int fd) {
+            std::vector<unsigned char> frame(sizeof(uint32_t));
+            size_t received = 0;
+
+            while (received < frame.size()) {
+                const auto n = ::recv(fd, frame.data() + received, frame.size() - received, 0);
+
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+
+                if (n <= 0) {
+                    throw DaemonError(n == 0 ? std::string("Connection closed by the daemon.")
+                                             : std::string("Failed to receive: ") + std::strerror(errno));
+                }
+
+                received += n;
+
+                if (received == sizeof(uint32_t)) {
+                    uint32_t length;
+                    std::memcpy(&length, frame.data(), sizeof(length));
+
+                    if (length > MAX_FRAME_SIZE) {
+                        throw DaemonError("Frame exceeds the maximum size.");
+                    }
+
+                    frame.resize(sizeof(uint32_t) + length);
+                }
+            }
+
+            return frame;
+        }
+    }
+}
+
+#endif /* GPGPU_DAEMON_PROTOCOL_HPP */
@@ -0,0 +1,666 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2014-2015 Sven-Kristofer Pilz
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef GPGPU_DAEMON_SERVER_HPP
+#define GPGPU_DAEMON_SERVER_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/stat.h>
+
+#include "../Buffer.hpp"
+#include "../Framebuffer.hpp"
+#include "../Program.hpp"
+#include "../ShaderCache.hpp"
+#include "../Texture.hpp"
+#include "Protocol.hpp"
+
+namespace gpgpu {
+    namespace daemon {
+        /*
+         * Declaration
+         */
+        static constexpr size_t DEFAULT_MAX_TARGETS = 16;
+        static constexpr size_t DEFAULT_TARGET_BUDGET = 512u << 20;
+        static constexpr size_t DEFAULT_MAX_PROGRAMS = 256;
+
+        /**
+         * Unsent result bytes above which a connection's pipelined jobs wait
+         * until the client has read some of its results.
+         */
+        static constexpr size_t MAX_PENDING_OUTPUT = 32u << 20;
+
+        /**
+         * Serves render jobs over a Unix domain socket from one warm
+         * context: programs stay compiled in a ShaderCache, render targets
+         * are pooled per size and format, vertex and index buffers are
+         * reused. Clients are multiplexed with poll() on the thread owning
+         * the context, jobs run in the order their frames arrive.
+         *
+         * Both pools are bounded, clients may send any size and shader:
+         * at most DEFAULT_MAX_TARGETS render targets using up to
+         * DEFAULT_TARGET_BUDGET bytes and DEFAULT_MAX_PROGRAMS programs are
+         * kept, the least recently used ones are evicted first.
+         */
+        class RenderServer : public OpenGLObject {
+        public:
+            /**
+             * Listens on `path`, replacing a stale socket file. The context
+             * has to be current.
+             */
+            explicit RenderServer(const std::string &path = DEFAULT_SOCKET_PATH, int backlog = 64);
+
+            ~RenderServer();
+
+            RenderServer(const RenderServer &) = delete;
+
+            RenderServer &operator=(const RenderServer &) = delete;
+
+            /**
+             * Serves clients until stop() is called.
+             */
+            void run();
+
+            /**
+             * Waits up to `timeout` milliseconds for I/O and handles it.
+             */
+            void poll(int timeout);
+
+            /**
+             * Safe to call from signal handlers and other threads.
+             */
+            void stop() {
+                _stop = true;
+            }
+
+            /**
+             * Runs a job in-process, errors are reported in the result.
+             */
+            RenderResult render(const RenderJob &job);
+
+            size_t clients() const {
+                return _connections.size();
+            }
+
+            size_t jobs() const {
+                return _jobs;
+            }
+
+            ShaderCache &cache() {
+                return _cache;
+            }
+
+            /**
+             * Caps the pooled render targets by number and bytes, the
+             * target of the current job is kept even if it exceeds `bytes`.
+             */
+            void set_target_limits(size_t count, size_t bytes);
+
+            size_t targets() const {
+                return _targets.size();
+            }
+
+            size_t target_bytes() const {
+                return _target_bytes;
+            }
+
+        protected:
+            struct Connection {
+                int fd;
+                std::vector<unsigned char> in;
+                std::vector<unsigned char> out;
+                size_t sent = 0;
+
+                bool backlogged() const {
+                    return out.size() - sent > MAX_PENDING_OUTPUT;
+                }
+            };
+
+            struct RenderTarget {
+                std::unique_ptr<Framebuffer> framebuffer;
+                std::shared_ptr<Texture2D> color;
+                size_t bytes = 0;
+                uint64_t used = 0;
+            };
+
+            std::string _path;
+            int _listener;
+            std::atomic<bool> _stop{false};
+            size_t _jobs = 0;
+            std::vector<std::unique_ptr<Connection>> _connections;
+
+            ShaderCache _cache;
+            std::map<std::tuple<uint32_t, uint32_t, uint8_t, bool>, RenderTarget> _targets;
+            size_t _max_targets = DEFAULT_MAX_TARGETS;
+            size_t _target_budget = DEFAULT_TARGET_BUDGET;
+            size_t _target_bytes = 0;
+            uint64_t _target_uses = 0;
+            std::shared_ptr<ArrayBuffer> _vertices;
+            // One index buffer per primitive mode, GL_POINTS to GL_TRIANGLE_FAN.
+            std::array<std::shared_ptr<ElementArrayBuffer>, GL_TRIANGLE_FAN + 1> _indices;
+            std::shared_ptr<ArrayBuffer> _triangle;
+
+            void accept();
+
+            /**
+             * @return False if the connection was closed.
+             */
+            bool receive(Connection &connection);
+
+            /**
+             * Runs the complete jobs received, until the connection is backlogged.
+             */
+            bool process(Connection &connection);
+
+            bool flush(Connection &connection);
+
+            RenderTarget &target(const RenderJob &job);
+
+            /**
+             * Evicts least recently used targets until `count` more targets
+             * with `bytes` more bytes fit into the limits.
+             */
+            void evict_targets(size_t count, size_t bytes);
+
+            void execute(const RenderJob &job, RenderResult &result);
+
+            /**
+             * int or ivec2-4, arrays of them with `count` > 1.
+             */
+            void set_integer_uniform(Program &program, const JobUniform &uniform) const;
+
+            /**
+             * Removes a socket file left behind by a daemon that is gone,
+             * throws if a daemon still accepts connections on it.
+             */
+            static void remove_stale_socket(const std::string &path);
+        };
+
+
+        /*
+         * Definition
+         */
+        inline RenderServer::RenderServer(const std::string &path, int backlog) : _path(path) {
+            const auto address = socket_address(path);
+
+            _listener = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (_listener < 0) {
+                throw DaemonError(std::string("Failed to create socket: ") + std::strerror(errno));
+            }
+
+            try {
+                remove_stale_socket(path);
+            } catch (...) {
+                ::close(_listener);
+                throw;
+            }
+
+            if (::bind(_listener, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 ||
+                ::listen(_listener, backlog) != 0) {
+                const std::string error = std::strerror(errno);
+                ::close(_listener);
+                throw DaemonError("Failed to listen on “" + path + "”: " + error);
+            }
+
+            ::fcntl(_listener, F_SETFL, O_NONBLOCK);
+            _cache.set_capacity(DEFAULT_MAX_PROGRAMS);
+
+            _vertices = std::make_shared<ArrayBuffer>();
+            _vertices->label("daemon");
+
+            const float triangle[] = {-1, -1, 3, -1, -1, 3};
+            _triangle = std::make_shared<ArrayBuffer>();
+            _triangle->data(3, 2, triangle);
+        }
+
+        inline void RenderServer::remove_stale_socket(const std::string &path) {
+            struct stat info;
+
+            // Never remove anything but a socket, bind() reports the path as in use then.
+            if (::lstat(path.c_str(), &info) != 0 || !S_ISSOCK(info.st_mode)) {
+                return;
+            }
+
+            const auto address = socket_address(path);
+            const int probe = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+            if (probe < 0) {
+                throw DaemonError(std::string("Failed to create socket: ") + std::strerror(errno));
+            }
+
+            const bool live = ::connect(probe, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+            const int error = errno;
+            ::close(probe);
+
+            if (live) {
+                throw DaemonError("A daemon is already listening on “" + path + "”.");
+            }
+
+            if (error == ECONNREFUSED) {
+                ::unlink(path.c_str());
+            }
+        }
+
+        inline RenderServer::~RenderServer() {
+            for (auto &connection : _connections) {
+                ::close(connection->fd);
+            }
+
+            ::close(_listener);
+            ::unlink(_path.c_str());
+        }
+
+        inline void RenderServer::run() {
+            while (!_stop) {
+                poll(200);
+            }
+        }
+
+        inline void RenderServer::poll(int timeout) {
+            std::vector<pollfd> fds(_connections.size() + 1);
+            fds[0] = {_listener, POLLIN, 0};
+
+            for (size_t i = 0; i < _connections.size(); ++i) {
+                // Backlogged clients aren't read from until they read their results.
+                const auto &c = *_connections[i];
+                const short events = (c.backlogged() ? 0 : POLLIN) | (c.sent < c.out.size() ? POLLOUT : 0);
+                fds[i + 1] = {c.fd, events, 0};
+            }
+
+            if (::poll(fds.data(), fds.size(), timeout) <= 0) {
+                // Timeout or interrupted by a signal, the caller checks for stop().
+                return;
+            }
+
+            // Iterate backwards, closed connections are erased in place.
+            for (size_t i = _connections.size(); i > 0; --i) {
+                auto &connection = *_connections[i - 1];
+                const auto events = fds[i].revents;
+                bool open = true;
+
+                if (events & (POLLIN | POLLHUP | POLLERR)) {
+                    open = receive(connection);
+                }
+
+                if (open && (events & POLLOUT)) {
+                    open = flush(connection);
+
+                    // Resume jobs held back while the connection was backlogged.
+                    if (open && !connection.backlogged() && !connection.in.empty()) {
+                        open = process(connection);
+                    }
+                }
+
+                if (!open) {
+                    ::close(connection.fd);
+                    _connections.erase(_connections.begin() + (i - 1));
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                accept();
+            }
+        }
+
+        inline void RenderServer::accept() {
+            for (;;) {
+                const int fd = ::accept4(_listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+                if (fd < 0) {
+                    return;
+                }
+
+                std::unique_ptr<Connection> connection(new Connection());
+                connection->fd = fd;
+                _connections.push_back(std::move(connection));
+            }
+        }
+
+        inline bool RenderServer::receive(Connection &connection) {
+            static constexpr size_t MAX_PENDING_INPUT = MAX_FRAME_SIZE + sizeof(uint32_t);
+            unsigned char chunk[64 * 1024];
+
+            try {
+                // Back to poll() once a frame is complete, a client that keeps writing would starve the others.
+                while (connection.in.size() < MAX_PENDING_INPUT &&
+                       complete_frame(connection.in.data(), connection.in.size()) == 0) {
+                    const size_t space = std::min(sizeof(chunk), MAX_PENDING_INPUT - connection.in.size());
+                    const auto n = ::recv(connection.fd, chunk, space, 0);
+
+                    if (n > 0) {
+                        connection.in.insert(connection.in.end(), chunk, chunk + n);
+                        continue;
+                    }
+
+                    if (n < 0 && errno == EINTR) {
+                        continue;
+                    }
+
+                    if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                        return false;
+                    }
+
+                    break;
+                }
+            } catch (const DaemonError &) {
+                // The frame length exceeds MAX_FRAME_SIZE.
+                return false;
+            }
+
+            return process(connection);
+        }
+
+        inline bool RenderServer::process(Connection &connection) {
+            // Drop results already sent, a client that never drains them completely would grow `out` otherwise.
+            connection.out.erase(connection.out.begin(), connection.out.begin() + connection.sent);
+            connection.sent = 0;
+
+            size_t consumed = 0;
+
+            try {
+                while (!connection.backlogged()) {
+                    const size_t size = complete_frame(connection.in.data() + consumed,
+                                                       connection.in.size() - consumed);
+
+                    if (size == 0) {
+                        break;
+                    }
+
+                    MessageReader reader(connection.in.data() + consumed + sizeof(uint32_t),
+                                         size - sizeof(uint32_t));
+                    consumed += size;
+
+                    RenderJob job;
+                    decode(reader, job);
+
+                    const auto frame = encode(render(job));
+                    connection.out.insert(connection.out.end(), frame.begin(), frame.end());
+                }
+            } catch (const DaemonError &) {
+                // Malformed frames leave the stream in an unknown state.
+                return false;
+            }
+
+            connection.in.erase(connection.in.begin(), connection.in.begin() + consumed);
+            return flush(connection);
+        }
+
+        inline bool RenderServer::flush(Connection &connection) {
+            while (connection.sent < connection.out.size()) {
+                const auto n = ::send(connection.fd, connection.out.data() + connection.sent,
+                                      connection.out.size() - connection.sent, MSG_NOSIGNAL);
+
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+
+                    // Wait for POLLOUT if the socket buffer is full.
+                    return errno == EAGAIN || errno == EWOULDBLOCK;
+                }
+
+                connection.sent += n;
+            }
+
+            connection.out.clear();
+            connection.sent = 0;
+            return true;
+        }
+
+        inline RenderResult RenderServer::render(const RenderJob &job) {
+            GPGPU_TRACE_SCOPE("RenderServer::render");
+            const auto start = std::chrono::steady_clock::now();
+            RenderResult result;
+
+            try {
+                execute(job, result);
+            } catch (const std::exception &e) {
+                result = RenderResult();
+                result.error = e.what();
+                // Don't let a failed job's GL error surface in the next one.
+                while (glGetError() != GL_NO_ERROR) {
+                }
+            }
+
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            ++_jobs;
+            return result;
+        }
+
+        inline void RenderServer::set_target_limits(size_t count, size_t bytes) {
+            _max_targets = std::max<size_t>(count, 1);
+            _target_budget = bytes;
+            evict_targets(0, 0);
+        }
+
+        inline void RenderServer::evict_targets(size_t count, size_t bytes) {
+            while (!_targets.empty() &&
+                   (_targets.size() + count > _max_targets || _target_bytes + bytes > _target_budget)) {
+                auto oldest = _targets.begin();
+
+                for (auto it = _targets.begin(); it != _targets.end(); ++it) {
+                    if (it->second.used < oldest->second.used) {
+                        oldest = it;
+                    }
+                }
+
+                _target_bytes -= oldest->second.bytes;
+                _targets.erase(oldest);
+            }
+        }
+
+        inline RenderServer::RenderTarget &RenderServer::target(const RenderJob &job) {
+            const auto key = std::make_tuple(job.width, job.height, static_cast<uint8_t>(job.format), job.depth_test);
+            auto it = _targets.find(key);
+
+            if (it != _targets.end()) {
+                it->second.used = ++_target_uses;
+                return it->second;
+            }
+
+            const size_t pixels = size_t(job.width) * job.height;
+            const size_t bytes = pixels * (job.format == RGBA32F ? 16 : 4) + (job.depth_test ? pixels * 4 : 0);
+            evict_targets(1, bytes);
+
+            RenderTarget target;
+            target.bytes = bytes;
+            target.used = ++_target_uses;
+
+            if (job.format == RGBA32F) {
+                target.color = std::make_shared<Texture2D>(job.width, job.height, GL_RGBA32F, GL_RGBA, GL_FLOAT);
+            } else {
+                target.color = std::make_shared<Texture2D>(job.width, job.height);
+            }
+
+            target.framebuffer.reset(new Framebuffer(job.width, job.height, job.depth_test));
+            target.framebuffer->set_color_attachment(target.color, 0);
+            target.framebuffer->label("daemon");
+            target.color->label("daemon");
+
+            _target_bytes += bytes;
+            return _targets.emplace(key, std::move(target)).first->second;
+        }
+
+        inline void RenderServer::set_integer_uniform(Program &program, const JobUniform &uniform) const {
+            const size_t components = size_t(uniform.rows) * uniform.cols;
+
+            // There are no integer matrices.
+            if ((uniform.rows != 1 && uniform.cols != 1) || components > 4) {
+                throw DaemonError("Integer uniform “" + uniform.name + "” must be a scalar or vector.");
+            }
+
+            std::vector<GLint> values(uniform.values.size());
+
+            for (size_t i = 0; i < values.size(); ++i) {
+                values[i] = static_cast<GLint>(uniform.values[i]);
+            }
+
+            const GLint location = program.uniformLocation(uniform.name);
+
+            switch (components) {
+                case 1:
+                    glUniform1iv(location, uniform.count, values.data());
+                    break;
+                case 2:
+                    glUniform2iv(location, uniform.count, values.data());
+                    break;
+                case 3:
+                    glUniform3iv(location, uniform.count, values.data());
+                    break;
+                default:
+                    glUniform4iv(location, uniform.count, values.data());
+                    break;
+            }
+
+            assertNoGLError("glUniform");
+        }
+
+        inline void RenderServer::execute(const RenderJob &job, RenderResult &result) {
+            if (job.width == 0 || job.height == 0) {
+                throw DaemonError("Output size must not be empty.");
+            }
+
+            if (job.format != RGBA8 && job.format != RGBA32F) {
+                throw DaemonError("Unknown output format.");
+            }
+
+            if (job.mode > GL_TRIANGLE_FAN) {
+                std::stringstream s;
+                s << "Unknown primitive mode 0x" << std::hex << job.mode << ".";
+                throw DaemonError(s.str());
+            }
+
+            GLint max_size;
+            glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+
+            if (job.width > static_cast<uint32_t>(max_size) || job.height > static_cast<uint32_t>(max_size)) {
+                std::stringstream s;
+                s << "Output size " << job.width << "x" << job.height << " exceeds the maximum texture size (" <<
+                        max_size << ").";
+                throw DaemonError(s.str());
+            }
+
+            // The result has to fit into one frame, the client can't receive it otherwise.
+            const size_t header = encode(RenderResult()).size() - sizeof(uint32_t);
+            const size_t pixels = size_t(job.width) * job.height * (job.format == RGBA8 ? 4 : 4 * sizeof(float));
+
+            if (pixels > MAX_FRAME_SIZE - header) {
+                std::stringstream s;
+                s << "Output of " << pixels << " bytes exceeds the maximum frame size (" << MAX_FRAME_SIZE << ").";
+                throw DaemonError(s.str());
+            }
+
+            auto &output = target(job);
+            output.framebuffer->bind();
+
+            ShaderTemplate vertex(Shader::Vertex, job.vertex_shader);
+            ShaderTemplate fragment(Shader::Fragment, job.fragment_shader);
+            auto program = _cache.program({&vertex, &fragment});
+            program->use();
+
+            for (const auto &u : job.uniforms) {
+                if (u.values.size() != size_t(u.rows) * u.cols * u.count || u.values.empty()) {
+                    throw DaemonError("Uniform “" + u.name + "” has the wrong number of values.");
+                }
+
+                if (u.integer) {
+                    set_integer_uniform(*program, u);
+                } else {
+                    program->setUniformLocation(program->uniformLocation(u.name), u.rows, u.cols, u.values.data(),
+                                                u.count);
+                }
+            }
+
+            if (job.vertices.empty()) {
+                program->attribute(job.attribute, _triangle);
+                program->enableAttributes();
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+                assertNoGLError("glDrawArrays");
+                program->disableAttributesAndClear();
+            } else {
+                if (job.dimension < 1 || job.dimension > 4 || job.vertices.size() % job.dimension != 0) {
+                    throw DaemonError("Vertices must have 1 to 4 components.");
+                }
+
+                _vertices->data(job.vertices.size() / job.dimension, job.dimension, job.vertices.data());
+                program->attribute(job.attribute, _vertices);
+
+                if (job.indices.empty()) {
+                    program->enableAttributes();
+                    glDrawArrays(job.mode, 0, _vertices->elements());
+                    assertNoGLError("glDrawArrays");
+                    program->disableAttributesAndClear();
+                } else {
+                    // The mode of an index buffer is fixed at construction.
+                    auto &indices = _indices[job.mode];
+
+                    if (!indices) {
+                        indices = std::make_shared<ElementArrayBuffer>(job.mode);
+                        indices->label("daemon");
+                    }
+
+                    indices->data_compact(job.indices.size(), 1, job.indices.data());
+                    program->render(*indices);
+                }
+            }
+
+            result.width = job.width;
+            result.height = job.height;
+            result.format = job.format;
+
+            const auto orientation = job.top_down ? Texture::TopDown : Texture::BottomUp;
+
+            if (job.format == RGBA8) {
+                result.pixels.resize(size_t(job.width) * job.height * 4);
+                output.color->read(result.pixels.data(), 0, orientation);
+            } else {
+                const size_t row = size_t(job.width) * 4 * sizeof(float);
+                result.pixels.resize(row * job.height);
+
+                output.color->bind();
+                glPixelStorei(GL_PACK_ALIGNMENT, 4);
+                glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_FLOAT, result.pixels.data());
+                assertNoGLError("glGetTexImage");
+                GPGPU_TRACE_DOWNLOAD("RenderServer::render", result.pixels.size());
+
+                if (job.top_down) {
+                    for (uint32_t y = 0; y < job.height / 2; ++y) {
+                        std::swap_ranges(result.pixels.begin() + y * row, result.pixels.begin() + (y + 1) * row,
+                                         result.pixels.begin() + (job.height - 1 - y) * row);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#endif /* GPGPU_DAEMON_SERVER_HPP */
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <gpgpu/daemon/Client.hpp>
+
+using namespace std;
+
+/*
+ * Usage: gpgpu-loadtest [socket] [clients] [jobs per client] [in flight per client] [size]
+ *
+ * Every client renders a triangle with a different camera into a size x size
+ * target, keeping several jobs in flight, and verifies the result.
+ */
+int main(int argc, char **argv) {
+    const string path = argc > 1 ? argv[1] : gpgpu::daemon::DEFAULT_SOCKET_PATH;
+    const int clients = argc > 2 ? atoi(argv[2]) : 4;
+    const int jobs = argc > 3 ? atoi(argv[3]) : 100;
+    const int in_flight = max(1, argc > 4 ? atoi(argv[4]) : 4);
+    const uint32_t size = argc > 5 ? atoi(argv[5]) : 256;
+
+    gpgpu::daemon::RenderJob job;
+    job.vertex_shader = R"(
+        #version 130
+        uniform mat4 camera;
+        in vec4 vertex;
+
+        void main() {
+            gl_Position = camera * vertex;
+        })";
+    job.fragment_shader = R"(
+        #version 130
+        out vec4 color;
+
+        void main() {
+            color = vec4(1.0, 0.0, 0.0, 1.0);
+        })";
+    job.vertices = {-0.5, -0.5, 0.0, 0.0, 0.5, 0.0, 0.5, -0.5, 0.0};
+    job.indices = {0, 1, 2};
+    job.width = size;
+    job.height = size;
+
+    gpgpu::daemon::JobUniform camera;
+    camera.name = "camera";
+    camera.rows = camera.cols = 4;
+    camera.values = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+    job.uniforms.push_back(camera);
+
+    mutex m;
+    vector<double> latencies;
+    size_t failures = 0;
+
+    const auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+
+    for (int c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            vector<double> local;
+            size_t failed = 0;
+
+            try {
+                gpgpu::daemon::RenderClient client(path);
+                vector<chrono::steady_clock::time_point> sent;
+                auto own = job;
+                int submitted = 0;
+
+                while (static_cast<int>(local.size() + failed) < jobs) {
+                    while (submitted < jobs && submitted - static_cast<int>(local.size() + failed) < in_flight) {
+                        // Shift the triangle per client, the center stays covered.
+                        own.uniforms[0].values[12] = 0.05f * (c % 4);
+                        client.send(own);
+                        sent.push_back(chrono::steady_clock::now());
+                        ++submitted;
+                    }
+
+                    const auto result = client.receive();
+                    const auto done = chrono::steady_clock::now();
+                    const size_t index = local.size() + failed;
+
+                    // Center pixel must be red.
+                    const size_t center = (size_t(size / 2) * size + size / 2) * 4;
+
+                    if (!result.error.empty() || result.pixels.size() != size_t(size) * size * 4 ||
+                        result.pixels[center] != 255) {
+                        ++failed;
+                    } else {
+                        local.push_back(chrono::duration<double, milli>(done - sent[index]).count());
+                    }
+                }
+            } catch (const exception &e) {
+                lock_guard<mutex> lock(m);
+                cerr << "client " << c << ": " << e.what() << endl;
+                failed = jobs - local.size();
+            }
+
+            lock_guard<mutex> lock(m);
+            latencies.insert(latencies.end(), local.begin(), local.end());
+            failures += failed;
+        });
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+
+    const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    sort(latencies.begin(), latencies.end());
+
+    auto percentile = [&](double p) {
+        return latencies.empty() ? 0.0 : latencies[min(latencies.size() - 1, size_t(p * latencies.size()))];
+    };
+
+    cout << clients << " clients x " << jobs << " jobs, " << in_flight << " in flight, " << size << "x" << size
+         << endl;
+    cout << "  completed: " << latencies.size() << ", failed: " << failures << endl;
+    cout << "  throughput: " << latencies.size() / seconds << " jobs/s" << endl;
+    cout << "  latency ms: p50=" << percentile(0.5) << " p90=" << percentile(0.9) << " p99=" << percentile(0.99)
+         << " max=" << (latencies.empty() ? 0.0 : latencies.back()) << endl;
+
+    return failures == 0 ? 0 : 1;
+}
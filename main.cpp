@@ -2,10 +2,9 @@
 
 #include <gpgpu/Context.hpp>
 #include <gpgpu/Framebuffer.hpp>
+#include <gpgpu/ImageWriter.hpp>
 #include <gpgpu/Program.hpp>
 
-#include <OpenImageIO/imagebufalgo.h>
-
 using namespace std;
 
 int main() {
@@ -86,10 +85,17 @@ int main() {
     // Or without indirection.
     //fixed_color_shader.render(geometry, "vertex", GL_TRIANGLES);
 
-    auto image = canvas->image();
-    OpenImageIO::ImageBuf output;
-    OpenImageIO::ImageBufAlgo::flip(output, *image);
-    output.write("canvas.png");
+    /*
+     * Output, encoded in the background while the context is free to render.
+     */
+    gpgpu::ImageWriter writer;
+    writer.write(canvas->image(gpgpu::Texture::TopDown), "canvas.png", false,
+                 [](const string &filename, const string &error) {
+                     if (!error.empty()) {
+                         cerr << "Failed to write " << filename << ": " << error << endl;
+                     }
+                 });
+    writer.wait();
 
     return 0;
 }
\ No newline at end of file